@@ -0,0 +1,152 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "arc_policy.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+ArcPolicy::ArcPolicy(const std::uint32_t numBufs)
+    : c(numBufs),
+      p(0),
+      queues(numBufs, NONE),
+      positions(numBufs),
+      keys(numBufs) {
+}
+
+void ArcPolicy::resize(const std::uint32_t numBufs) {
+  std::lock_guard<std::mutex> guard(latch);
+  c = numBufs;
+  p = std::min(p, c);
+  // per frame state is only ever grown; frames past the end are untracked
+  if (numBufs > queues.size()) {
+    queues.resize(numBufs, NONE);
+    positions.resize(numBufs);
+    keys.resize(numBufs);
+  }
+  trimGhosts();
+}
+
+void ArcPolicy::frameLoaded(const FrameId frame, const File* file,
+                            const PageId pageNo) {
+  std::lock_guard<std::mutex> guard(latch);
+  const PageKey key = {file, pageNo};
+  keys[frame] = key;
+  queues[frame] = T1;
+  std::unordered_map<PageKey, Ghost, PageKeyHash>::iterator ghost =
+      ghosts.find(key);
+  if (ghost != ghosts.end()) {
+    // a ghost hit means the list it was evicted from was too small
+    const std::uint32_t b1Size = b1.size();
+    const std::uint32_t b2Size = b2.size();
+    if (ghost->second.queue == B1) {
+      const std::uint32_t delta = std::max<std::uint32_t>(1, b2Size / b1Size);
+      p = std::min(c, p + delta);
+    } else {
+      const std::uint32_t delta = std::max<std::uint32_t>(1, b1Size / b2Size);
+      p = p > delta ? p - delta : 0;
+    }
+    ghostListOf(ghost->second.queue).erase(ghost->second.pos);
+    ghosts.erase(ghost);
+    queues[frame] = T2;
+  }
+  std::list<FrameId>& queue = listOf(queues[frame]);
+  queue.push_front(frame);
+  positions[frame] = queue.begin();
+  trimGhosts();
+}
+
+void ArcPolicy::frameAccessed(const FrameId frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  if (queues[frame] == NONE) {
+    return;
+  }
+  // any hit makes the page frequent
+  t2.splice(t2.begin(), listOf(queues[frame]), positions[frame]);
+  queues[frame] = T2;
+}
+
+void ArcPolicy::frameFreed(const FrameId frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  if (queues[frame] == NONE) {
+    return;
+  }
+  listOf(queues[frame]).erase(positions[frame]);
+  queues[frame] = NONE;
+}
+
+void ArcPolicy::dropGhost(const Queue queue) {
+  std::list<PageKey>& list = ghostListOf(queue);
+  ghosts.erase(list.back());
+  list.pop_back();
+}
+
+void ArcPolicy::trimGhosts() {
+  while (t1.size() + b1.size() > c && !b1.empty()) {
+    dropGhost(B1);
+  }
+  while (t1.size() + t2.size() + b1.size() + b2.size() > 2 * c) {
+    dropGhost(b2.empty() ? B1 : B2);
+  }
+}
+
+bool ArcPolicy::pickFrom(const Queue queue, VictimCheck& check,
+                         std::uint32_t window, FrameId& frame) {
+  std::list<FrameId>& frames = listOf(queue);
+  for (std::list<FrameId>::reverse_iterator it = frames.rbegin();
+       it != frames.rend() && window > 0; ++it, window--) {
+    if (check.tryClaim(*it)) {
+      frame = *it;
+      frames.erase(positions[frame]);
+      queues[frame] = NONE;
+      const Queue ghostQueue = queue == T1 ? B1 : B2;
+      std::list<PageKey>& ghostList = ghostListOf(ghostQueue);
+      ghostList.push_front(keys[frame]);
+      Ghost& ghost = ghosts[keys[frame]];
+      ghost.queue = ghostQueue;
+      ghost.pos = ghostList.begin();
+      trimGhosts();
+      return true;
+    }
+  }
+  return false;
+}
+
+ArcPolicy::Queue ArcPolicy::preferredQueue(const File* file,
+                                           const PageId pageNo) const {
+  // REPLACE from the paper: evict from T1 if it is over its target size, or
+  // exactly at it when the incoming page is a B2 ghost
+  const PageKey key = {file, pageNo};
+  std::unordered_map<PageKey, Ghost, PageKeyHash>::const_iterator ghost =
+      ghosts.find(key);
+  const bool inB2 = ghost != ghosts.end() && ghost->second.queue == B2;
+  if (!t1.empty() && (t1.size() > p || (inB2 && t1.size() == p))) {
+    return T1;
+  }
+  return T2;
+}
+
+bool ArcPolicy::pickVictim(const File* file, const PageId pageNo,
+                           VictimCheck& check, FrameId& frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  const Queue first = preferredQueue(file, pageNo);
+  const Queue second = first == T1 ? T2 : T1;
+  return pickFrom(first, check, listOf(first).size(), frame) ||
+      pickFrom(second, check, listOf(second).size(), frame);
+}
+
+bool ArcPolicy::probeVictim(const File* file, const PageId pageNo,
+                            VictimCheck& check, const std::uint32_t window,
+                            FrameId& frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  // only the list a victim is due from, so a probe never upsets the balance
+  // between T1 and T2
+  return pickFrom(preferredQueue(file, pageNo), check, window, frame);
+}
+
+}
@@ -0,0 +1,182 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Adaptive Replacement Cache (Megiddo and Modha).
+ *
+ * Resident pages are split between T1 (seen once recently) and T2 (seen at
+ * least twice).  Ghost lists B1 and B2 remember pages recently evicted from
+ * each, and hits on them move the target size p of T1, so the policy adapts
+ * between recency and frequency on its own.
+ *
+ * Victims must be unpinned, so when every frame of the preferred list is
+ * pinned the victim is taken from the other list.
+ */
+class ArcPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructs an ARC policy.
+   *
+   * @param numBufs   Number of frames in the buffer pool
+   */
+  ArcPolicy(const std::uint32_t numBufs);
+
+  const char* name() const override { return "ARC"; }
+
+  void frameLoaded(const FrameId frame, const File* file,
+                   const PageId pageNo) override;
+
+  void frameAccessed(const FrameId frame) override;
+
+  void frameFreed(const FrameId frame) override;
+
+  void resize(const std::uint32_t numBufs) override;
+
+  bool pickVictim(const File* file, const PageId pageNo,
+                  VictimCheck& check, FrameId& frame) override;
+
+  bool probeVictim(const File* file, const PageId pageNo, VictimCheck& check,
+                   const std::uint32_t window, FrameId& frame) override;
+
+ private:
+  /**
+   * List a frame or ghost page is on
+   */
+  enum Queue { NONE, T1, T2, B1, B2 };
+
+  /**
+   * Location of a ghost page
+   */
+  struct Ghost {
+    Queue queue;
+    std::list<PageKey>::iterator pos;
+  };
+
+  /**
+   * Tries to claim a victim from T1 or T2, least recently used first, and
+   * remembers it on the matching ghost list.
+   *
+   * @param queue   T1 or T2
+   * @param check   Used to claim candidate frames
+   * @param window  Most frames of the list offered to check
+   * @param frame   Victim frame, set on success
+   * @return  True if a frame was claimed.
+   */
+  bool pickFrom(const Queue queue, VictimCheck& check, std::uint32_t window,
+                FrameId& frame);
+
+  /**
+   * Returns the list REPLACE from the paper evicts from next.  The latch must
+   * be held.
+   *
+   * @param file    File of the page that will be loaded
+   * @param pageNo  Page number of the page that will be loaded
+   * @return  T1 or T2.
+   */
+  Queue preferredQueue(const File* file, const PageId pageNo) const;
+
+  /**
+   * Forgets the least recently evicted page of a ghost list.
+   *
+   * @param queue   B1 or B2
+   */
+  void dropGhost(const Queue queue);
+
+  /**
+   * Trims the ghost lists so |T1| + |B1| <= c and the directory holds at
+   * most 2c pages.
+   */
+  void trimGhosts();
+
+  /**
+   * Returns the list backing a resident queue.
+   *
+   * @param queue   T1 or T2
+   * @return  List of frames, most recently used first.
+   */
+  std::list<FrameId>& listOf(const Queue queue) {
+    return queue == T1 ? t1 : t2;
+  }
+
+  /**
+   * Returns the list backing a ghost queue.
+   *
+   * @param queue   B1 or B2
+   * @return  List of pages, most recently evicted first.
+   */
+  std::list<PageKey>& ghostListOf(const Queue queue) {
+    return queue == B1 ? b1 : b2;
+  }
+
+  /**
+   * Protects all members below
+   */
+  std::mutex latch;
+
+  /**
+   * Number of frames in the buffer pool
+   */
+  std::uint32_t c;
+
+  /**
+   * Target size of T1
+   */
+  std::uint32_t p;
+
+  /**
+   * Resident pages seen once, most recently used first
+   */
+  std::list<FrameId> t1;
+
+  /**
+   * Resident pages seen at least twice, most recently used first
+   */
+  std::list<FrameId> t2;
+
+  /**
+   * Pages evicted from T1, most recently evicted first
+   */
+  std::list<PageKey> b1;
+
+  /**
+   * Pages evicted from T2, most recently evicted first
+   */
+  std::list<PageKey> b2;
+
+  /**
+   * Location of every page on B1 or B2
+   */
+  std::unordered_map<PageKey, Ghost, PageKeyHash> ghosts;
+
+  /**
+   * Queue of each frame
+   */
+  std::vector<Queue> queues;
+
+  /**
+   * Position of each frame in its queue
+   */
+  std::vector<std::list<FrameId>::iterator> positions;
+
+  /**
+   * Page held by each frame
+   */
+  std::vector<PageKey> keys;
+};
+
+}
@@ -6,6 +6,7 @@
  */
 
 #include <memory>
+#include <new>
 #include <iostream>
 #include "buffer.h"
 #include "bufHashTbl.h"
@@ -15,100 +16,176 @@
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File* file, const PageId pageNo)
+std::uint64_t BufHashTbl::hash(const File* file, const PageId pageNo)
 {
-  int tmp, value;
-  tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
+  // combine the identity of the file object with the page number, then run
+  // the splitmix64 finalizer so consecutive pages of a file spread over all
+  // partitions and buckets
+  std::uint64_t value = reinterpret_cast<std::uintptr_t>(file);
+  value ^= pageNo * 0x9E3779B97F4A7C15ULL;
+  value ^= value >> 30;
+  value *= 0xBF58476D1CE4E5B9ULL;
+  value ^= value >> 27;
+  value *= 0x94D049BB133111EBULL;
+  value ^= value >> 31;
   return value;
 }
 
-BufHashTbl::BufHashTbl(int htSize)
-	: HTSIZE(htSize)
+BufHashTbl::BufHashTbl(const std::uint32_t numBufs)
 {
-  // allocate an array of pointers to hashBuckets
-  ht = new hashBucket* [htSize];
-  for(int i=0; i < HTSIZE; i++)
-    ht[i] = NULL;
+  // aim for each partition to be at most half full when the pool is full
+  const std::uint32_t perPartition = numBufs / NUM_PARTITIONS + 1;
+  std::uint32_t capacity = 8;
+  while (capacity < 2 * perPartition)
+    capacity *= 2;
+
+  for (int i = 0; i < NUM_PARTITIONS; i++) {
+    partitions[i].buckets = new hashBucket[capacity]();
+    partitions[i].capacity = capacity;
+    partitions[i].count = 0;
+  }
 }
 
 BufHashTbl::~BufHashTbl()
 {
-  for(int i = 0; i < HTSIZE; i++) {
-    hashBucket* tmpBuf = ht[i];
-    while (ht[i]) {
-      tmpBuf = ht[i];
-      ht[i] = ht[i]->next;
-      delete tmpBuf;
-    }
-  }
-  delete [] ht;
+  for (int i = 0; i < NUM_PARTITIONS; i++)
+    delete [] partitions[i].buckets;
 }
 
-void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+std::int64_t BufHashTbl::find(const Partition& part, const std::uint64_t hashValue,
+                              const File* file, const PageId pageNo)
 {
-  int index = hash(file, pageNo);
+  const std::uint32_t mask = part.capacity - 1;
+  std::uint32_t index = hashValue & mask;
+  for (std::uint32_t distance = 1; ; distance++) {
+    const hashBucket& bucket = part.buckets[index];
+    // an empty bucket, or one closer to its home than we are to ours, means
+    // the key would have been placed before this point
+    if (bucket.distance < distance)
+      return -1;
+    if (bucket.file == file && bucket.pageNo == pageNo)
+      return index;
+    index = (index + 1) & mask;
+  }
+}
 
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-  		throw HashAlreadyPresentException(tmpBuc->file->filename(), tmpBuc->pageNo, tmpBuc->frameNo);
-    tmpBuc = tmpBuc->next;
+void BufHashTbl::place(Partition& part, hashBucket bucket)
+{
+  const std::uint32_t mask = part.capacity - 1;
+  std::uint32_t index = hash(bucket.file, bucket.pageNo) & mask;
+  bucket.distance = 1;
+  while (part.buckets[index].distance != 0) {
+    if (part.buckets[index].distance < bucket.distance) {
+      // take from the rich: the resident is closer to home, so it moves on
+      hashBucket displaced = part.buckets[index];
+      part.buckets[index] = bucket;
+      bucket = displaced;
+    }
+    index = (index + 1) & mask;
+    bucket.distance++;
   }
+  part.buckets[index] = bucket;
+  part.count++;
+}
+
+void BufHashTbl::grow(Partition& part)
+{
+  hashBucket* oldBuckets = part.buckets;
+  const std::uint32_t oldCapacity = part.capacity;
 
-  tmpBuc = new hashBucket;
-  if (!tmpBuc)
+  hashBucket* newBuckets = new (std::nothrow) hashBucket[oldCapacity * 2]();
+  if (!newBuckets)
   	throw HashTableException();
 
-  tmpBuc->file = (File*) file;
-  tmpBuc->pageNo = pageNo;
-  tmpBuc->frameNo = frameNo;
-  tmpBuc->next = ht[index];
-  ht[index] = tmpBuc;
+  part.buckets = newBuckets;
+  part.capacity = oldCapacity * 2;
+  part.count = 0;
+  for (std::uint32_t i = 0; i < oldCapacity; i++) {
+    if (oldBuckets[i].distance != 0)
+      place(part, oldBuckets[i]);
+  }
+  delete [] oldBuckets;
 }
 
-void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
+void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
 {
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-    {
-      frameNo = tmpBuc->frameNo; // return frameNo by reference
-      return;
-    }
-    tmpBuc = tmpBuc->next;
+  if (!tryInsert(file, pageNo, frameNo)) {
+    FrameId presentFrameNo = frameNo;
+    tryLookup(file, pageNo, presentFrameNo);
+  	throw HashAlreadyPresentException(file->filename(), pageNo, presentFrameNo);
   }
+}
 
-  throw HashNotFoundException(file->filename(), pageNo);
+bool BufHashTbl::tryInsert(const File* file, const PageId pageNo, const FrameId frameNo)
+{
+  const std::uint64_t hashValue = hash(file, pageNo);
+  Partition& part = partitionFor(hashValue);
+  std::lock_guard<std::mutex> guard(part.latch);
+
+  if (find(part, hashValue, file, pageNo) >= 0)
+    return false;
+
+  if ((part.count + 1) * 100 > part.capacity * MAX_LOAD_PERCENT)
+    grow(part);
+
+  hashBucket bucket;
+  bucket.file = file;
+  bucket.pageNo = pageNo;
+  bucket.frameNo = frameNo;
+  place(part, bucket);
+  return true;
+}
+
+void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo)
+{
+  if (!tryLookup(file, pageNo, frameNo))
+    throw HashNotFoundException(file->filename(), pageNo);
+}
+
+bool BufHashTbl::tryLookup(const File* file, const PageId pageNo, FrameId &frameNo)
+{
+  const std::uint64_t hashValue = hash(file, pageNo);
+  Partition& part = partitionFor(hashValue);
+  std::lock_guard<std::mutex> guard(part.latch);
+
+  const std::int64_t index = find(part, hashValue, file, pageNo);
+  if (index < 0)
+    return false;
+
+  frameNo = part.buckets[index].frameNo; // return frameNo by reference
+  return true;
 }
 
 void BufHashTbl::remove(const File* file, const PageId pageNo) {
 
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  hashBucket* prevBuc = NULL;
-
-  while (tmpBuc)
-	{
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-		{
-      if(prevBuc) 
-				prevBuc->next = tmpBuc->next;
-      else
-				ht[index] = tmpBuc->next;
-
-      delete tmpBuc;
-      return;
-    }
-		else
-		{
-      prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
-    }
-  }
+  if (!tryRemove(file, pageNo))
+    throw HashNotFoundException(file->filename(), pageNo);
+}
 
-  throw HashNotFoundException(file->filename(), pageNo);
+bool BufHashTbl::tryRemove(const File* file, const PageId pageNo) {
+
+  const std::uint64_t hashValue = hash(file, pageNo);
+  Partition& part = partitionFor(hashValue);
+  std::lock_guard<std::mutex> guard(part.latch);
+
+  const std::int64_t found = find(part, hashValue, file, pageNo);
+  if (found < 0)
+    return false;
+
+  // shift the following run of displaced buckets back by one so lookups never
+  // need tombstones
+  const std::uint32_t mask = part.capacity - 1;
+  std::uint32_t index = found;
+  std::uint32_t next = (index + 1) & mask;
+  while (part.buckets[next].distance > 1) {
+    part.buckets[index] = part.buckets[next];
+    part.buckets[index].distance--;
+    index = next;
+    next = (next + 1) & mask;
+  }
+  part.buckets[index].distance = 0;
+  part.count--;
+  return true;
 }
 
 }
@@ -7,18 +7,23 @@
 
 #pragma once
 
+#include <cstdint>
+#include <mutex>
+
 #include "file.h"
 
 namespace badgerdb {
 
 /**
 * @brief Declarations for buffer pool hash table
+*
+* Buckets are stored inline in the table; an empty bucket has a distance of 0.
 */
 struct hashBucket {
 	/**
 	 * pointer a file object (more on this below)
 	 */
-	File *file;
+	const File *file;
 
 	/**
 	 * page number within a file
@@ -31,49 +36,136 @@ struct hashBucket {
 	FrameId frameNo;
 
 	/**
-	 * Next node in the hash table
+	 * One more than the distance of this bucket from the bucket its key hashes
+	 * to, or 0 if the bucket is empty
 	 */
-	hashBucket*   next;
+	std::uint32_t distance;
 };
 
 
 /**
 * @brief Hash table class to keep track of pages in the buffer pool
 *
-* @warning This class is not threadsafe.
+* The table is split into NUM_PARTITIONS partitions, each guarded by its own
+* latch, so threads working on pages that hash to different partitions never
+* contend with each other.  Every public method is threadsafe.
+*
+* Each partition is a flat, power-of-two sized array of buckets using Robin
+* Hood open addressing with backward-shift deletion, so lookups touch a short
+* run of adjacent buckets and inserts and removes never allocate.
 */
 class BufHashTbl
 {
+ public:
+	/**
+	 * Number of independently latched partitions of the hash table
+	 */
+  static const int NUM_PARTITIONS = 16;
+
  private:
 	/**
-	 *	Size of Hash Table
+	 * A partition grows once it is more than MAX_LOAD_PERCENT full
 	 */
-  int HTSIZE;
+  static const std::uint32_t MAX_LOAD_PERCENT = 75;
+
+	/**
+	 * One independently latched open addressing table
+	 */
+  struct Partition {
+		/**
+		 * Latch protecting the members of this partition
+		 */
+    std::mutex latch;
+
+		/**
+		 * Array of capacity buckets
+		 */
+    hashBucket* buckets;
+
+		/**
+		 * Number of buckets, always a power of two
+		 */
+    std::uint32_t capacity;
+
+		/**
+		 * Number of buckets in use
+		 */
+    std::uint32_t count;
+  };
+
 	/**
-	 * Actual Hash table object
+	 * Partitions of the table
 	 */
-  hashBucket**  ht;
+  Partition partitions[NUM_PARTITIONS];
 
 	/**
-	 * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+	 * returns a well mixed 64-bit hash value computed using file and pageNo.
+	 * The high half selects the partition and the low half the bucket.
 	 *
 	 * @param file   	File object
 	 * @param pageNo  Page number in the file
 	 * @return  			Hash value.
 	 */
-  int	 hash(const File* file, const PageId pageNo);
+  static std::uint64_t hash(const File* file, const PageId pageNo);
+
+	/**
+	 * Returns the partition responsible for the given hash value
+	 *
+	 * @param hashValue  Value returned by hash()
+	 * @return  			Partition holding that key.
+	 */
+  Partition& partitionFor(const std::uint64_t hashValue)
+  {
+    return partitions[(hashValue >> 32) % NUM_PARTITIONS];
+  }
+
+	/**
+	 * Returns the index of the bucket holding (file, pageNo) in the partition,
+	 * or -1 if it is not present.  The partition latch must be held.
+	 *
+	 * @param part   	Partition to search
+	 * @param hashValue  Value returned by hash() for file and pageNo
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			Index of the bucket, or -1.
+	 */
+  static std::int64_t find(const Partition& part, const std::uint64_t hashValue,
+                           const File* file, const PageId pageNo);
+
+	/**
+	 * Places a bucket into the partition, displacing buckets closer to their
+	 * home as Robin Hood hashing requires.  The key must not be present, there
+	 * must be a free bucket and the partition latch must be held.
+	 *
+	 * @param part   	Partition to insert into
+	 * @param bucket  Bucket to insert; its distance is ignored
+	 */
+  static void place(Partition& part, hashBucket bucket);
+
+	/**
+	 * Doubles the capacity of the partition and reinserts every bucket.  The
+	 * partition latch must be held.
+	 *
+	 * @param part   	Partition to grow
+   * @throws  HashTableException if the larger bucket array can't be allocated
+	 */
+  static void grow(Partition& part);
 
  public:
 	/**
-   * Constructor of BufHashTbl class
+   * Constructor of BufHashTbl class.  Partitions are sized so the table can
+   * hold one entry per buffer frame while staying at most about half full;
+   * a partition that still fills up past MAX_LOAD_PERCENT grows on its own.
+   *
+   * @param numBufs  Number of frames in the buffer pool
 	 */
-	BufHashTbl(const int htSize);  // constructor
+	BufHashTbl(const std::uint32_t numBufs);  // constructor
 
 	/**
    * Destructor of BufHashTbl class
 	 */
   ~BufHashTbl(); // destructor
-	
+
 	/**
    * Insert entry into hash table mapping (file, pageNo) to frameNo.
 	 *
@@ -81,10 +173,23 @@ class BufHashTbl
 	 * @param pageNo 	Page number in the file
 	 * @param frameNo Frame number assigned to that page of the file
    * @throws  HashAlreadyPresentException	if the corresponding page already exists in the hash table
-   * @throws  HashTableException (optional) if could not create a new bucket as running of memory
+   * @throws  HashTableException if a partition had to grow and ran out of memory
 	 */
   void insert(const File* file, const PageId pageNo, const FrameId frameNo);
 
+	/**
+   * Insert entry into hash table mapping (file, pageNo) to frameNo, unless
+   * (file, pageNo) is already present.  Unlike insert() this does not throw
+   * when the entry exists, so callers can use it on hot paths.
+	 *
+	 * @param file   	File object
+	 * @param pageNo 	Page number in the file
+	 * @param frameNo Frame number assigned to that page of the file
+	 * @return  			True if the entry was inserted, false if it was already present.
+   * @throws  HashTableException if a partition had to grow and ran out of memory
+	 */
+  bool tryInsert(const File* file, const PageId pageNo, const FrameId frameNo);
+
 	/**
    * Check if (file, pageNo) is currently in the buffer pool (ie. in
    * the hash table).
@@ -92,18 +197,38 @@ class BufHashTbl
 	 * @param file  	File object
 	 * @param pageNo	Page number in the file
 	 * @param frameNo Frame number reference
-   * @throws HashNotFoundException if the page entry is not found in the hash table 
+   * @throws HashNotFoundException if the page entry is not found in the hash table
 	 */
   void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
 
+	/**
+   * Check if (file, pageNo) is currently in the buffer pool (ie. in
+   * the hash table) without throwing if it is not.
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference, only set if the entry is found
+	 * @return  			True if the entry was found.
+	 */
+  bool tryLookup(const File* file, const PageId pageNo, FrameId &frameNo);
+
 	/**
    * Delete entry (file,pageNo) from hash table.
 	 *
 	 * @param file   	File object
 	 * @param pageNo  Page number in the file
-   * @throws HashNotFoundException if the page entry is not found in the hash table 
+   * @throws HashNotFoundException if the page entry is not found in the hash table
+	 */
+  void remove(const File* file, const PageId pageNo);
+
+	/**
+   * Delete entry (file,pageNo) from hash table if it is present.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			True if the entry was found and removed.
 	 */
-  void remove(const File* file, const PageId pageNo);  
+  bool tryRemove(const File* file, const PageId pageNo);
 };
 
 }
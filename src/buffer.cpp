@@ -15,10 +15,20 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+
 #include <memory>
 
 #include <iostream>
 
+#include <chrono>
+
+#include <new>
+
+#include <sys/mman.h>
+
+#include <unistd.h>
+
 #include "buffer.h"
 
 #include "exceptions/buffer_exceeded_exception.h"
@@ -38,115 +48,1108 @@
 namespace badgerdb 
 {
 
+  const std::uint32_t BufMgr::DEFAULT_GROWTH_FACTOR;
+
   //----------------------------------------
-  // Constructor of the class BufMgr
+  // Claims victims for the replacement policy
   //----------------------------------------
 
-  BufMgr::BufMgr(std::uint32_t bufs): numBufs(bufs) 
+  class BufMgr::FrameClaim : public VictimCheck 
   {
-    bufDescTable = new BufDesc[bufs];
+   public:
+    FrameClaim(BufMgr * mgr, const bool cleanOnly): mgr(mgr), cleanOnly(cleanOnly) 
+    {
+    }
 
-    for (FrameId i = 0; i < bufs; i++) 
+    bool tryClaim(const FrameId frame) override 
     {
-      bufDescTable[i].frameNo = i;
-      bufDescTable[i].valid = false;
+      BufDesc & desc = mgr -> bufDescTable[frame];
+      std::unique_lock<std::mutex> latch(desc.latch, std::try_to_lock);
+      if (!latch.owns_lock() || !desc.valid || desc.pinCnt > 0 || desc.ioInProgress) 
+      {
+        return false;
+      }
+      if (cleanOnly && desc.dirty) 
+      {
+        return false;
+      }
+      // readers of this page now wait until it has been written back and
+      // dropped, see BufMgr::evict
+      desc.ioInProgress = true;
+      return true;
     }
 
-    bufPool = new Page[bufs];
+   private:
+    BufMgr * mgr;
+    // only claim frames that can be reused without writing them back
+    bool cleanOnly;
+  };
 
-    int htsize = ((((int)(bufs * 1.2)) * 2) / 2) + 1;
-    hashTable = new BufHashTbl(htsize); // allocate the buffer hash table
+  //----------------------------------------
+  // Constructor of the class BufMgr
+  //----------------------------------------
+
+  BufMgr::BufMgr(std::uint32_t bufs, const ReplacementPolicyType policyType, const bool hugePages,
+                 const std::uint32_t maxPoolBufs): numBufs(bufs),
+    maxBufs(maxPoolBufs == 0 ? std::min<std::uint64_t>(static_cast<std::uint64_t>(bufs) * DEFAULT_GROWTH_FACTOR, UINT32_MAX) : std::max(bufs, maxPoolBufs)), builtBufs(0), bgRunning(false), bgPasses(0), bgLastPassIdle(false), prefetchRunning(false), prefetchCurrent(NULL), numPageTables(0) 
+  {
+    mapPool(hugePages);
+
+    // hand out low frame numbers first
+    freeFrames.reserve(bufs);
+    for (FrameId i = bufs; i > 0; i--) 
+    {
+      freeFrames.push_back(i - 1);
+    }
 
-    clockHand = bufs - 1;
+    hashTable = new BufHashTbl(bufs); // allocate the buffer hash table
+    for (int i = 0; i < MAX_PAGE_TABLES; i++) 
+    {
+      pageTables[i] = NULL;
+    }
+
+    policy = ReplacementPolicy::create(policyType, bufDescTable, bufs);
   }
 
   BufMgr::~BufMgr() 
   {
-    // write back dirty pages to disk
-    for (FrameId i = 0; i < numBufs; i++) 
     {
-      if (bufDescTable[i].dirty == true) 
+      std::lock_guard<std::mutex> lock(prefetchMutex);
+      prefetchRunning = false;
+      prefetchQueue.clear();
+      prefetchWake.notify_all();
+    }
+    if (prefetcher.joinable()) 
+    {
+      prefetcher.join();
+    }
+    stopBackgroundWriter();
+
+    // write back dirty pages to disk, file by file in page number order
+    for (const auto & entry : fileFrames) 
+    {
+      File * file = NULL;
+      std::vector<const Page*> pages;
+      for (const auto & page : entry.second) 
+      {
+        if (bufDescTable[page.second].dirty == true) 
+        {
+          file = bufDescTable[page.second].file;
+          pages.push_back(&bufPool[page.second]);
+        }
+      }
+      if (file != NULL) 
       {
-        bufDescTable[i].file -> writePage(bufPool[i]);
+        file -> writePages(pages.data(), pages.size());
       }
     }
+    delete policy;
     delete hashTable;
-    delete[] bufDescTable;
-    delete[] bufPool;
+    for (int i = 0; i < numPageTables.load(); i++) 
+    {
+      delete pageTables[i].load();
+    }
+    for (FilePageTable * retired : retiredPageTables) 
+    {
+      delete retired;
+    }
+    for (FrameId i = 0; i < builtBufs; i++) 
+    {
+      bufDescTable[i].~BufDesc();
+    }
+    munmap(bufDescTable, descBytes);
+    munmap(bufPool, poolBytes);
+  }
+
+  void BufMgr::mapPool(const bool hugePages) 
+  {
+    // mmap() returns page aligned memory, so every frame is aligned for
+    // DIRECT files and their pages are transferred without a bounce buffer
+    static_assert(Page::SIZE % FileIO::DIRECT_ALIGNMENT == 0,
+      "Frames must stay aligned for direct I/O.");
+    // reserve address space for the largest pool up front, so resize()
+    // never moves a frame; buildFrames() makes the frames in use accessible
+    poolBytes = static_cast<std::size_t>(maxBufs) * Page::SIZE;
+    const std::size_t align = hugePages ? HUGE_PAGE_SIZE : 0;
+    void * region = mmap(NULL, poolBytes + align, PROT_NONE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (region == MAP_FAILED) 
+    {
+      throw std::bad_alloc();
+    }
+    char * start = static_cast<char *>(region);
+    if (hugePages) 
+    {
+      // trim the mapping so the pool starts on a huge page boundary
+      const std::size_t misalign = reinterpret_cast<std::uintptr_t>(start) % HUGE_PAGE_SIZE;
+      const std::size_t head = misalign == 0 ? 0 : HUGE_PAGE_SIZE - misalign;
+      if (head > 0) 
+      {
+        munmap(start, head);
+      }
+      if (align - head > 0) 
+      {
+        munmap(start + head + poolBytes, align - head);
+      }
+      start += head;
+#ifdef MADV_HUGEPAGE
+      // only advice: without THP support the pool simply uses small pages
+      madvise(start, poolBytes, MADV_HUGEPAGE);
+#endif
+    }
+    bufPool = reinterpret_cast<Page *>(start);
+
+    // the descriptors hold latches and condition variables, which can't be
+    // moved either
+    descBytes = static_cast<std::size_t>(maxBufs) * sizeof(BufDesc);
+    void * descs = mmap(NULL, descBytes, PROT_NONE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (descs == MAP_FAILED) 
+    {
+      munmap(bufPool, poolBytes);
+      throw std::bad_alloc();
+    }
+    bufDescTable = static_cast<BufDesc *>(descs);
+    buildFrames(numBufs);
+  }
+
+  void BufMgr::buildFrames(const std::uint32_t bufs) 
+  {
+    if (bufs <= builtBufs) 
+    {
+      return;
+    }
+    if (mprotect(& bufPool[builtBufs], static_cast<std::size_t>(bufs - builtBufs) * Page::SIZE,
+                 PROT_READ | PROT_WRITE) != 0) 
+    {
+      throw std::bad_alloc();
+    }
+    // descriptors don't line up with memory pages, so round out to them
+    const std::uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+    const std::uintptr_t first = reinterpret_cast<std::uintptr_t>(& bufDescTable[builtBufs]) & ~(pageSize - 1);
+    const std::uintptr_t last = (reinterpret_cast<std::uintptr_t>(& bufDescTable[bufs]) + pageSize - 1) & ~(pageSize - 1);
+    if (mprotect(reinterpret_cast<void *>(first), last - first, PROT_READ | PROT_WRITE) != 0) 
+    {
+      throw std::bad_alloc();
+    }
+    for (FrameId i = builtBufs; i < bufs; i++) 
+    {
+      new (& bufPool[i]) Page(Page::NoInit());
+      new (& bufDescTable[i]) BufDesc();
+      bufDescTable[i].frameNo = i;
+    }
+    builtBufs = bufs;
   }
 
-  void BufMgr::advanceClock() 
+  bool BufMgr::resize(const std::uint32_t bufs) 
   {
-    clockHand = (clockHand + 1) % numBufs;
+    if (bufs == 0 || bufs > maxBufs) 
+    {
+      return false;
+    }
+    std::lock_guard<std::mutex> guard(resizeLatch);
+    const std::uint32_t oldBufs = numBufs;
+    if (bufs < oldBufs) 
+    {
+      return shrink(bufs);
+    }
+    buildFrames(bufs);
+    // the policy must be able to track the new frames before they are used
+    policy -> resize(bufs);
+    numBufs = bufs;
+    std::lock_guard<std::mutex> freeGuard(freeLatch);
+    for (FrameId i = bufs; i > oldBufs; i--) 
+    {
+      freeFrames.push_back(i - 1);
+    }
+    return true;
   }
 
-  void BufMgr::allocBuf(FrameId & frame) 
+  bool BufMgr::shrink(const std::uint32_t bufs) 
   {
-    // count loops; if 2 loops around the clock complete, then
-    // all frames must have pinned pages
-    uint32_t cntLoops = 0;
-    while (cntLoops < (2 * numBufs)) 
+    const std::uint32_t oldBufs = numBufs;
+    // frames past the new end this call holds: ones taken off the free list,
+    // and ones whose page it evicted
+    std::vector<bool> held(oldBufs - bufs, false);
+    std::vector<FrameId> taken;
+    std::vector<FrameId> evicted;
     {
-      advanceClock();
-      BufDesc & curr = bufDescTable[clockHand];
-      if (!curr.valid) 
+      std::lock_guard<std::mutex> guard(freeLatch);
+      std::vector<FrameId>::iterator keep = freeFrames.begin();
+      for (const FrameId frame : freeFrames) 
       {
-        // unused page found, use it
-        break;
+        if (frame >= bufs) 
+        {
+          held[frame - bufs] = true;
+          taken.push_back(frame);
+        } 
+        else 
+        {
+          * keep++ = frame;
+        }
       }
-      if (!curr.refbit && curr.pinCnt == 0) 
+      freeFrames.erase(keep, freeFrames.end());
+    }
+
+    // look for pinned frames before evicting anything, so a shrink that
+    // can't succeed usually leaves the cache as it was
+    bool dropped = true;
+    for (FrameId frame = bufs; frame < oldBufs && dropped; frame++) 
+    {
+      BufDesc & desc = bufDescTable[frame];
+      std::lock_guard<std::mutex> latch(desc.latch);
+      dropped = held[frame - bufs] || (desc.valid && desc.pinCnt == 0 && !desc.ioInProgress);
+    }
+    for (FrameId frame = bufs; frame < oldBufs && dropped; frame++) 
+    {
+      if (held[frame - bufs]) 
+      {
+        continue;
+      }
+      BufDesc & desc = bufDescTable[frame];
       {
-        // valid but unpinned page found, may be evicted
-        if (curr.dirty) 
+        std::lock_guard<std::mutex> latch(desc.latch);
+        // pinned, being read or evicted, or allocated but not loaded yet
+        dropped = desc.valid && desc.pinCnt == 0 && !desc.ioInProgress;
+        if (dropped) 
         {
-          // flush dirty page to disk
-          curr.file -> writePage(bufPool[clockHand]);
+          // claim it the way the replacement policy's victims are claimed
+          desc.ioInProgress = true;
         }
+      }
+      if (dropped) 
+      {
+        policy -> frameFreed(frame);
         try 
         {
-          // if an entry in the hashtable exists, remove it
-          hashTable -> remove(curr.file, curr.pageNo);
-        } catch (HashNotFoundException & e) 
+          evict(frame);
+        } 
+        catch (...) 
         {
+          // evict() put the page back; give back the other frames
+          dropped = false;
         }
-        break;
       }
-      bufDescTable[clockHand].refbit = false;
-      cntLoops++;
+      if (dropped) 
+      {
+        evicted.push_back(frame);
+      }
+    }
+
+    if (!dropped) 
+    {
+      for (const FrameId frame : evicted) 
+      {
+        releaseBuf(frame);
+      }
+      std::lock_guard<std::mutex> guard(freeLatch);
+      freeFrames.insert(freeFrames.end(), taken.begin(), taken.end());
+      return false;
+    }
+
+    policy -> resize(bufs);
+    numBufs = bufs;
+    for (const FrameId frame : evicted) 
+    {
+      std::lock_guard<std::mutex> latch(bufDescTable[frame].latch);
+      bufDescTable[frame].Clear();
+    }
+    // give the memory of the dropped frames back; their descriptors stay, as
+    // threads that looked up a page just before it was evicted may still be
+    // waiting on them
+    madvise(& bufPool[bufs], static_cast<std::size_t>(oldBufs - bufs) * Page::SIZE, MADV_DONTNEED);
+    return true;
+  }
+
+  bool BufMgr::setMemoryLimit(const std::uint64_t bytes) 
+  {
+    const std::uint64_t frameBytes = Page::SIZE + sizeof(BufDesc);
+    const std::uint64_t bufs = std::min<std::uint64_t>(bytes / frameBytes, maxBufs);
+    return resize(bufs > 0 ? bufs : 1);
+  }
+
+  void BufMgr::allocBuf(FrameId & frame, const File * file, const PageId pageNo) 
+  {
+    bool found = false;
+    {
+      std::lock_guard<std::mutex> guard(freeLatch);
+      if (!freeFrames.empty()) 
+      {
+        // unused frame found, use it
+        frame = freeFrames.back();
+        freeFrames.pop_back();
+        found = true;
+      }
     }
-    if (cntLoops >= (2 * numBufs)) 
+    if (found) 
+    {
+      // reserve the frame for the caller
+      std::lock_guard<std::mutex> latch(bufDescTable[frame].latch);
+      bufDescTable[frame].pinCnt = 1;
+      return;
+    }
+
+    if (bgRunning) 
+    {
+      // prefer a victim the background writer has already cleaned, if one is
+      // among the next few the policy would evict anyway
+      FrameClaim cleanClaim(this, true);
+      if (policy -> probeVictim(file, pageNo, cleanClaim, CLEAN_VICTIM_WINDOW, frame)) 
+      {
+        evict(frame);
+        return;
+      }
+    }
+    FrameClaim claim(this, false);
+    if (!policy -> pickVictim(file, pageNo, claim, frame)) 
     {
       // throw BufferExceededException if all buffer frames are pinned
       throw BufferExceededException();
     }
-    // return value
-    frame = clockHand;
+    evict(frame);
+  }
+
+  void BufMgr::evict(const FrameId frame) 
+  {
+    BufDesc & desc = bufDescTable[frame];
+    File * file;
+    PageId pageNo;
+    bool dirty;
+    {
+      std::lock_guard<std::mutex> latch(desc.latch);
+      file = desc.file;
+      pageNo = desc.pageNo;
+      dirty = desc.dirty;
+    }
+    if (dirty) 
+    {
+      // flush dirty page to disk
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      try 
+      {
+        file -> writePage(bufPool[frame]);
+        bufStats.diskwrites++;
+      } 
+      catch (...) 
+      {
+        // leave the page where it was
+        {
+          std::lock_guard<std::mutex> latch(desc.latch);
+          desc.ioInProgress = false;
+          desc.ioDone.notify_all();
+        }
+        policy -> frameLoaded(frame, file, pageNo);
+        throw;
+      }
+      bufStats.stallMicros += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+      if (bgRunning) 
+      {
+        // the writer is falling behind
+        bgWake.notify_one();
+      }
+    }
+    // if an entry in the hashtable exists, remove it
+    unpublishFrame(file, pageNo, frame);
+
+    // reserve the frame for the caller
+    std::lock_guard<std::mutex> latch(desc.latch);
+    desc.Clear();
+    desc.pinCnt = 1;
+    desc.ioDone.notify_all();
+  }
+
+  void BufMgr::releaseBuf(const FrameId frame) 
+  {
+    BufDesc & desc = bufDescTable[frame];
+    {
+      std::lock_guard<std::mutex> latch(desc.latch);
+      desc.Clear();
+      desc.ioDone.notify_all();
+    }
+    std::lock_guard<std::mutex> guard(freeLatch);
+    freeFrames.push_back(frame);
+  }
+
+  void BufMgr::freeBuf(const FrameId frame) 
+  {
+    policy -> frameFreed(frame);
+    std::lock_guard<std::mutex> guard(freeLatch);
+    freeFrames.push_back(frame);
+  }
+
+  PageTable * BufMgr::pageTableOf(const File * file) const 
+  {
+    const int count = numPageTables.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++) 
+    {
+      FilePageTable * slot = pageTables[i].load(std::memory_order_acquire);
+      if (slot != NULL && slot -> file == file) 
+      {
+        return &slot -> table;
+      }
+    }
+    return NULL;
+  }
+
+  bool BufMgr::lookupFrame(const File * file, const PageId pageNo, FrameId & frame) 
+  {
+    PageTable * table = pageTableOf(file);
+    if (table != NULL) 
+    {
+      return table -> tryLookup(pageNo, frame);
+    }
+    return hashTable -> tryLookup(file, pageNo, frame);
+  }
+
+  bool BufMgr::publishFrame(const File * file, const PageId pageNo, const FrameId frame) 
+  {
+    PageTable * table = pageTableOf(file);
+    if (table != NULL ? !table -> tryInsert(pageNo, frame) : !hashTable -> tryInsert(file, pageNo, frame)) 
+    {
+      return false;
+    }
+    indexFrame(file, pageNo, frame);
+    return true;
+  }
+
+  void BufMgr::unpublishFrame(const File * file, const PageId pageNo, const FrameId frame) 
+  {
+    PageTable * table = pageTableOf(file);
+    if (table != NULL ? table -> tryRemove(pageNo) : hashTable -> tryRemove(file, pageNo)) 
+    {
+      unindexFrame(file, pageNo, frame);
+    }
+  }
+
+  bool BufMgr::enablePageTable(File * file) 
+  {
+    // the prefetcher loads under the load latch, so stop it first
+    cancelPrefetch(file);
+    // no page of the file can be published until it has moved; pages already
+    // in the pool are in the hash table, so drop them first
+    std::lock_guard<std::mutex> load(loadLatchOf(file));
+    dropFrames(file);
+    std::lock_guard<std::mutex> guard(pageTablesLatch);
+    const int count = numPageTables.load();
+    int slot = count;
+    for (int i = 0; i < count; i++) 
+    {
+      const FilePageTable * owner = pageTables[i].load();
+      if (owner != NULL && owner -> file == file) 
+      {
+        return true;
+      }
+      if (owner == NULL && slot == count) 
+      {
+        slot = i;
+      }
+    }
+    if (slot == MAX_PAGE_TABLES) 
+    {
+      return false;
+    }
+    pageTables[slot].store(new FilePageTable(file, file -> numPages()), std::memory_order_release);
+    if (slot == count) 
+    {
+      numPageTables.store(count + 1, std::memory_order_release);
+    }
+    return true;
+  }
+
+  void BufMgr::disablePageTable(File * file) 
+  {
+    cancelPrefetch(file);
+    std::lock_guard<std::mutex> load(loadLatchOf(file));
+    dropFrames(file);
+    std::lock_guard<std::mutex> guard(pageTablesLatch);
+    for (int i = 0; i < numPageTables.load(); i++) 
+    {
+      FilePageTable * owner = pageTables[i].load();
+      if (owner != NULL && owner -> file == file) 
+      {
+        pageTables[i].store(NULL, std::memory_order_release);
+        retiredPageTables.push_back(owner);
+      }
+    }
+  }
+
+  void BufMgr::indexFrame(const File * file, const PageId pageNo, const FrameId frame) 
+  {
+    std::lock_guard<std::mutex> guard(fileFramesLatch);
+    fileFrames[file][pageNo] = frame;
+  }
+
+  void BufMgr::unindexFrame(const File * file, const PageId pageNo, const FrameId frame) 
+  {
+    std::lock_guard<std::mutex> guard(fileFramesLatch);
+    auto entry = fileFrames.find(file);
+    if (entry == fileFrames.end()) 
+    {
+      return;
+    }
+    auto page = entry -> second.find(pageNo);
+    if (page != entry -> second.end() && page -> second == frame) 
+    {
+      entry -> second.erase(page);
+      if (entry -> second.empty()) 
+      {
+        fileFrames.erase(entry);
+      }
+    }
+  }
+
+  std::vector<FrameId> BufMgr::framesOf(const File * file) 
+  {
+    std::vector<FrameId> frames;
+    std::lock_guard<std::mutex> guard(fileFramesLatch);
+    auto entry = fileFrames.find(file);
+    if (entry != fileFrames.end()) 
+    {
+      frames.reserve(entry -> second.size());
+      for (const auto & page : entry -> second) 
+      {
+        frames.push_back(page.second);
+      }
+    }
+    return frames;
+  }
+
+  bool BufMgr::claimDirty(const FrameId frame, const File * expected, File * & file) 
+  {
+    BufDesc & desc = bufDescTable[frame];
+    std::lock_guard<std::mutex> latch(desc.latch);
+    if (!desc.valid || !desc.dirty || desc.pinCnt > 0 || desc.ioInProgress ||
+        (expected != NULL && desc.file != expected)) 
+    {
+      return false;
+    }
+    // keep the page from being pinned, and so changed, while it is written
+    desc.ioInProgress = true;
+    file = desc.file;
+    return true;
+  }
+
+  std::uint32_t BufMgr::writeClaimed(File * file, const std::vector<FrameId> & frames,
+                                     const bool background) 
+  {
+    std::vector<const Page*> pages;
+    pages.reserve(frames.size());
+    for (const FrameId frame : frames) 
+    {
+      pages.push_back(&bufPool[frame]);
+    }
+    bool written = false;
+    try 
+    {
+      file -> writePages(pages.data(), pages.size());
+      written = true;
+    } 
+    catch (...) 
+    {
+      // leave the pages dirty; a foreground eviction or flushFile will retry
+      // them one by one and report the error
+    }
+    for (const FrameId frame : frames) 
+    {
+      BufDesc & desc = bufDescTable[frame];
+      std::lock_guard<std::mutex> latch(desc.latch);
+      if (written) 
+      {
+        desc.dirty = false;
+        bufStats.diskwrites++;
+        if (background) 
+        {
+          bufStats.bgwrites++;
+        }
+      }
+      desc.ioInProgress = false;
+      desc.ioDone.notify_all();
+    }
+    return written ? frames.size() : 0;
+  }
+
+  void BufMgr::bgWriterLoop() 
+  {
+    FrameId cursor = 0;
+    std::unique_lock<std::mutex> lock(bgMutex);
+    while (bgRunning) 
+    {
+      lock.unlock();
+
+      // estimate the fraction of unpinned pages that are dirty
+      std::uint32_t unpinned = 0;
+      std::uint32_t dirty = 0;
+      for (FrameId i = 0; i < numBufs; i++) 
+      {
+        BufDesc & desc = bufDescTable[i];
+        std::unique_lock<std::mutex> latch(desc.latch, std::try_to_lock);
+        if (latch.owns_lock() && desc.valid && desc.pinCnt == 0) 
+        {
+          unpinned++;
+          if (desc.dirty) 
+          {
+            dirty++;
+          }
+        }
+      }
+
+      const bool idle = unpinned == 0 || dirty <= bgConfig.highWatermark * unpinned;
+      if (!idle) 
+      {
+        // clean round robin over the pool until below the low watermark
+        const std::chrono::microseconds gap(bgConfig.writesPerSecond == 0 ? 0 :
+          1000000 / bgConfig.writesPerSecond);
+        // without a rate limit, pages of the same file are written in
+        // batches the file's I/O engine can keep in flight together
+        const std::uint32_t batchSize = gap.count() > 0 ? 1 : IO_BATCH;
+        std::vector<FrameId> batch;
+        File* batchFile = NULL;
+        for (std::uint32_t scanned = 0; scanned < numBufs && bgRunning &&
+             dirty > bgConfig.lowWatermark * unpinned + batch.size(); scanned++) 
+        {
+          const FrameId frame = cursor;
+          cursor = (cursor + 1) % numBufs;
+          File* file;
+          if (!claimDirty(frame, NULL, file)) 
+          {
+            continue;
+          }
+          if (!batch.empty() && file != batchFile) 
+          {
+            dirty -= writeClaimed(batchFile, batch, true);
+            batch.clear();
+          }
+          batchFile = file;
+          batch.push_back(frame);
+          if (batch.size() == batchSize) 
+          {
+            dirty -= writeClaimed(batchFile, batch, true);
+            batch.clear();
+            if (gap.count() > 0) 
+            {
+              std::this_thread::sleep_for(gap);
+            }
+          }
+        }
+        if (!batch.empty()) 
+        {
+          dirty -= writeClaimed(batchFile, batch, true);
+        }
+      }
+
+      lock.lock();
+      bgPasses++;
+      bgLastPassIdle = idle;
+      bgPassDone.notify_all();
+      if (bgRunning) 
+      {
+        bgWake.wait_for(lock, std::chrono::milliseconds(bgConfig.intervalMillis));
+      }
+    }
+  }
+
+  void BufMgr::startBackgroundWriter(const BgWriterConfig & config) 
+  {
+    stopBackgroundWriter();
+    bgConfig = config;
+    bgRunning = true;
+    bgWriter = std::thread(&BufMgr::bgWriterLoop, this);
+  }
+
+  void BufMgr::stopBackgroundWriter() 
+  {
+    {
+      std::lock_guard<std::mutex> lock(bgMutex);
+      bgRunning = false;
+      bgWake.notify_all();
+      bgPassDone.notify_all();
+    }
+    if (bgWriter.joinable()) 
+    {
+      bgWriter.join();
+    }
+  }
+
+  void BufMgr::waitForBackgroundWriter() 
+  {
+    std::unique_lock<std::mutex> lock(bgMutex);
+    // the pass running now may have looked at the pool before this call, so
+    // it takes the one after it
+    const std::uint64_t start = bgPasses;
+    bgWake.notify_all();
+    while (bgRunning && (bgPasses < start + 2 || !bgLastPassIdle)) 
+    {
+      bgPassDone.wait(lock);
+      bgWake.notify_all();
+    }
+  }
+
+  bool BufMgr::reclaimBuf(const BufferRing::Slot & slot) 
+  {
+    BufDesc & desc = bufDescTable[slot.frame];
+    {
+      std::lock_guard<std::mutex> latch(desc.latch);
+      if (!desc.valid || desc.file != slot.file || desc.pageNo != slot.pageNo ||
+          desc.pinCnt > 0 || desc.ioInProgress) 
+      {
+        // evicted, or in use by someone else
+        return false;
+      }
+      // claim it the way the replacement policy's victims are claimed
+      desc.ioInProgress = true;
+    }
+    policy -> frameFreed(slot.frame);
+    evict(slot.frame);
+    return true;
+  }
+
+  bool BufMgr::startLoad(File * file, const PageId pageNo, FrameId & frame,
+                         BufferRing * ring, const bool batched) 
+  {
+    // failure, allocate new page in buffer
+    if (ring != NULL && ring -> slots[ring -> next].used && reclaimBuf(ring -> slots[ring -> next])) 
+    {
+      frame = ring -> slots[ring -> next].frame;
+    } 
+    else 
+    {
+      allocBuf(frame, file, pageNo);
+    }
+    if (ring != NULL) 
+    {
+      // from here on the slot's old frame is either this one or no longer ours
+      ring -> slots[ring -> next].used = false;
+    }
+    BufDesc & desc = bufDescTable[frame];
+    {
+      // the frame is ours until it is in the hashtable, so publish it
+      // as being read before anyone can find it
+      std::lock_guard<std::mutex> latch(desc.latch);
+      desc.file = file;
+      desc.pageNo = pageNo;
+      desc.ioInProgress = true;
+    }
+    bool published;
+    if (batched) 
+    {
+      // loadBatch() holds the load latch for the whole batch
+      published = publishFrame(file, pageNo, frame);
+    } 
+    else 
+    {
+      std::lock_guard<std::mutex> load(loadLatchOf(file));
+      published = publishFrame(file, pageNo, frame);
+    }
+    if (!published) 
+    {
+      releaseBuf(frame);
+      return false;
+    }
+    return true;
+  }
+
+  void BufMgr::finishLoad(const FrameId frame, const bool pin, BufferRing * ring) 
+  {
+    BufDesc & desc = bufDescTable[frame];
+    File * file;
+    PageId pageNo;
+    bufStats.diskreads++;
+    {
+      std::lock_guard<std::mutex> latch(desc.latch);
+      file = desc.file;
+      pageNo = desc.pageNo;
+    }
+    // track the frame while ioInProgress still keeps others from claiming
+    // it, so it can't be dropped before the policy knows about it
+    policy -> frameLoaded(frame, file, pageNo);
+    {
+      std::lock_guard<std::mutex> latch(desc.latch);
+      desc.Set(file, pageNo);
+      if (!pin) 
+      {
+        desc.pinCnt = 0;
+      }
+      desc.ioInProgress = false;
+      desc.ioDone.notify_all();
+    }
+    if (ring != NULL) 
+    {
+      BufferRing::Slot & slot = ring -> slots[ring -> next];
+      slot.used = true;
+      slot.frame = frame;
+      slot.file = file;
+      slot.pageNo = pageNo;
+      ring -> next = (ring -> next + 1) % ring -> slots.size();
+    }
+  }
+
+  void BufMgr::abortLoad(const FrameId frame) 
+  {
+    BufDesc & desc = bufDescTable[frame];
+    File * file;
+    PageId pageNo;
+    {
+      std::lock_guard<std::mutex> latch(desc.latch);
+      file = desc.file;
+      pageNo = desc.pageNo;
+    }
+    unpublishFrame(file, pageNo, frame);
+    releaseBuf(frame);
+  }
+
+  bool BufMgr::loadBuf(File * file, const PageId pageNo, FrameId & frame, const bool pin,
+                       BufferRing * ring) 
+  {
+    if (!startLoad(file, pageNo, frame, ring)) 
+    {
+      return false;
+    }
+    try 
+    {
+      file -> readPage(pageNo, bufPool[frame]);
+    } 
+    catch (...) 
+    {
+      // file->readPage may throw an exception; if so, undo the
+      // hashtable and description table updates
+      abortLoad(frame);
+      throw;
+    }
+    finishLoad(frame, pin, ring);
+    return true;
+  }
+
+  void BufMgr::loadBatch(File * file, const std::vector<PageId> & pageNos) 
+  {
+    std::vector<PageId> loading;
+    std::vector<FrameId> frames;
+    std::vector<Page*> pages;
+    {
+      // the reads below happen without the latch, so a page table change
+      // waiting for it also waits for their frames instead of blocking them
+      std::lock_guard<std::mutex> load(loadLatchOf(file));
+      for (const PageId pageNo : pageNos) 
+      {
+        FrameId frame;
+        if (lookupFrame(file, pageNo, frame)) 
+        {
+          continue;
+        }
+        try 
+        {
+          if (!startLoad(file, pageNo, frame, NULL, true)) 
+          {
+            continue;
+          }
+        } 
+        catch (...) 
+        {
+          // the pool is full of pinned pages; read what we have frames for
+          break;
+        }
+        loading.push_back(pageNo);
+        frames.push_back(frame);
+        pages.push_back(&bufPool[frame]);
+      }
+    }
+    if (frames.empty()) 
+    {
+      return;
+    }
+
+    std::unique_ptr<bool[]> valid(new bool[frames.size()]);
+    try 
+    {
+      file -> readPages(loading.data(), pages.data(), frames.size(), valid.get());
+    } 
+    catch (...) 
+    {
+      for (std::size_t i = 0; i < frames.size(); i++) 
+      {
+        valid[i] = false;
+      }
+    }
+    for (std::size_t i = 0; i < frames.size(); i++) 
+    {
+      if (valid[i]) 
+      {
+        finishLoad(frames[i], false, NULL);
+        bufStats.prefetches++;
+      } 
+      else 
+      {
+        // pages that don't exist are left for readPage to report
+        abortLoad(frames[i]);
+      }
+    }
+  }
+
+  void BufMgr::prefetcherLoop() 
+  {
+    std::unique_lock<std::mutex> lock(prefetchMutex);
+    std::vector<PageId> pageNos;
+    while (true) 
+    {
+      while (prefetchRunning && prefetchQueue.empty()) 
+      {
+        prefetchWake.wait(lock);
+      }
+      if (!prefetchRunning) 
+      {
+        return;
+      }
+      // take the requests at the front of the queue for the same file, to be
+      // read in one batch
+      File* file = prefetchQueue.front().file;
+      pageNos.clear();
+      while (!prefetchQueue.empty() && prefetchQueue.front().file == file &&
+             pageNos.size() < IO_BATCH) 
+      {
+        pageNos.push_back(prefetchQueue.front().pageNo);
+        prefetchQueue.pop_front();
+      }
+      prefetchCurrent = file;
+      lock.unlock();
+
+      // prefetching is only a hint: if the pool is full of pinned pages or a
+      // page does not exist, readPage will report it
+      loadBatch(file, pageNos);
+
+      lock.lock();
+      prefetchCurrent = NULL;
+      prefetchWake.notify_all();
+    }
+  }
+
+  void BufMgr::prefetch(File * file, const PageId first, const PageId count) 
+  {
+    std::vector<PageId> pageNos;
+    pageNos.reserve(count);
+    for (PageId pageNo = first; pageNo - first < count; pageNo++) 
+    {
+      pageNos.push_back(pageNo);
+    }
+    prefetch(file, pageNos);
+  }
+
+  void BufMgr::prefetch(File * file, const std::vector<PageId> & pageNos) 
+  {
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+    if (!prefetcher.joinable()) 
+    {
+      prefetchRunning = true;
+      prefetcher = std::thread(&BufMgr::prefetcherLoop, this);
+    }
+    for (const PageId pageNo : pageNos) 
+    {
+      const PrefetchRequest request = {file, pageNo};
+      prefetchQueue.push_back(request);
+    }
+    prefetchWake.notify_all();
+  }
+
+  void BufMgr::waitForPrefetches() 
+  {
+    std::unique_lock<std::mutex> lock(prefetchMutex);
+    while (!prefetchQueue.empty() || prefetchCurrent != NULL) 
+    {
+      prefetchWake.wait(lock);
+    }
+  }
+
+  void BufMgr::dropPrefetch(const File * file, const PageId pageNo) 
+  {
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+    for (std::deque<PrefetchRequest>::iterator it = prefetchQueue.begin(); it != prefetchQueue.end(); ++it) 
+    {
+      if (it -> file == file && it -> pageNo == pageNo) 
+      {
+        prefetchQueue.erase(it);
+        return;
+      }
+    }
+  }
+
+  void BufMgr::cancelPrefetch(const File * file) 
+  {
+    std::unique_lock<std::mutex> lock(prefetchMutex);
+    for (std::deque<PrefetchRequest>::iterator it = prefetchQueue.begin(); it != prefetchQueue.end();) 
+    {
+      if (it -> file == file) 
+      {
+        it = prefetchQueue.erase(it);
+      } 
+      else 
+      {
+        ++it;
+      }
+    }
+    while (prefetchCurrent == file) 
+    {
+      prefetchWake.wait(lock);
+    }
   }
 
   void BufMgr::readPage(File * file,
     const PageId pageNo, Page * & page) 
     {
+    page = & bufPool[pinPage(file, pageNo, NULL)];
+  }
+
+  void BufMgr::readPage(File * file,
+    const PageId pageNo, Page * & page, BufferRing & ring) 
+    {
+    page = & bufPool[pinPage(file, pageNo, & ring)];
+  }
+
+  PageHandle BufMgr::readPage(File * file, const PageId pageNo) 
+  {
+    return PageHandle(this, pinPage(file, pageNo, NULL), file, pageNo);
+  }
+
+  PageHandle BufMgr::readPage(File * file, const PageId pageNo, BufferRing & ring) 
+  {
+    return PageHandle(this, pinPage(file, pageNo, & ring), file, pageNo);
+  }
+
+  FrameId BufMgr::pinPage(File * file, const PageId pageNo, BufferRing * ring) 
+  {
     FrameId frameNo;
-    try 
+    bufStats.accesses++;
+    while (true) 
     {
-      hashTable -> lookup(file, pageNo, frameNo);
+      if (!lookupFrame(file, pageNo, frameNo)) 
+      {
+        // failure, read the page into a new frame, and make sure a prefetch
+        // that has fallen behind does not read it a second time
+        dropPrefetch(file, pageNo);
+        if (!loadBuf(file, pageNo, frameNo, true, ring)) 
+        {
+          // another thread got there first; wait for its read instead
+          continue;
+        }
+        return frameNo;
+      }
+
+      BufDesc & desc = bufDescTable[frameNo];
+      std::unique_lock<std::mutex> latch(desc.latch);
+      while (desc.ioInProgress) 
+      {
+        // another thread is reading this page from disk, or evicting it
+        desc.ioDone.wait(latch);
+      }
+      if (!desc.valid || desc.file != file || desc.pageNo != pageNo) 
+      {
+        // frame was evicted or the read failed after our lookup; try again
+        continue;
+      }
       // success
-      bufDescTable[frameNo].refbit = true;
-      bufDescTable[frameNo].pinCnt++;
-      // return value
-      page = & bufPool[frameNo];
-    } 
-    catch (const HashNotFoundException & e) 
-    {
-      // failure, allocate new page in buffer
-      allocBuf(frameNo);
-      bufPool[frameNo] = file -> readPage(pageNo);
-      // file->readPage may throw an exception; if so, don't update
-      // the hashtable or description table
-      hashTable -> insert(file, pageNo, frameNo);
-      bufDescTable[frameNo].Set(file, pageNo);
-      // return value
-      page = & bufPool[frameNo];
+      desc.pinCnt++;
+      latch.unlock();
+      bufStats.hits++;
+      policy -> frameAccessed(frameNo);
+      return frameNo;
     }
   }
 
@@ -159,26 +1162,48 @@ namespace badgerdb
     //Hash table maps file/pageNo to index of page in buffer
     FrameId frameNo;
     //Find if the this file/page/frameNo is in the buffer
-    try 
-    {
-      hashTable -> lookup(file, pageNo, frameNo);
-    }
-    //file/page/frameNo not found in buffer
-    catch (HashNotFoundException & e) 
+    if (!lookupFrame(file, pageNo, frameNo)) 
     {
+      //file/page/frameNo not found in buffer
       std::cout << "Hash exception"<<"\n";
       return;
     }
 
+    BufDesc & desc = bufDescTable[frameNo];
+    std::lock_guard<std::mutex> latch(desc.latch);
+    if (desc.file != file || desc.pageNo != pageNo) 
+    {
+      // evicted since the lookup, so it can't have been pinned
+      throw PageNotPinnedException(file -> filename(), pageNo, frameNo);
+    }
     //If the page already not pinned -> throw exception
-    if (bufDescTable[frameNo].pinCnt == 0) 
+    if (desc.pinCnt == 0) 
     {
-      throw PageNotPinnedException(file -> filename(), bufDescTable[frameNo].pageNo, frameNo); // Recently Edited
+      throw PageNotPinnedException(file -> filename(), desc.pageNo, frameNo); // Recently Edited
     }
-    bufDescTable[frameNo].pinCnt = bufDescTable[frameNo].pinCnt - 1;
+    desc.pinCnt--;
     if (dirty) 
     {
-      bufDescTable[frameNo].dirty = true;
+      desc.dirty = true;
+    }
+  }
+
+  void BufMgr::unPinFrame(const FrameId frameNo, const File * file, const PageId pageNo,
+                          const bool dirty) 
+  {
+    BufDesc & desc = bufDescTable[frameNo];
+    std::lock_guard<std::mutex> latch(desc.latch);
+    // the handle's pin keeps the frame from being reused, so only a caller
+    // mixing handles with unPinPage() can find another page here, or its own
+    // page unpinned
+    if (desc.file != file || desc.pageNo != pageNo || desc.pinCnt == 0) 
+    {
+      throw PageNotPinnedException(file -> filename(), pageNo, frameNo);
+    }
+    desc.pinCnt--;
+    if (dirty) 
+    {
+      desc.dirty = true;
     }
   }
 
@@ -188,68 +1213,177 @@ namespace badgerdb
   //Output: Page number and Page object that was allocated
   void BufMgr::allocPage(File * file, PageId & pageNo, Page * & page) 
   {
-    FrameId frameNo;
-    //Allocate an empty page
-    Page allocPage = file -> allocatePage();
-    //Allocate a new buffer.  If buffer is full throws exception up stack
-    allocBuf(frameNo);
+    //Return pointer to buffer pool
+    page = & bufPool[newPage(file, pageNo)];
+  }
 
-    pageNo = allocPage.page_number();
-    bufPool[frameNo] = allocPage;
+  PageHandle BufMgr::allocPage(File * file) 
+  {
+    PageId pageNo;
+    const FrameId frameNo = newPage(file, pageNo);
+    return PageHandle(this, frameNo, file, pageNo);
+  }
 
-    hashTable -> insert(file, pageNo, frameNo);
+  FrameId BufMgr::newPage(File * file, PageId & pageNo) 
+  {
+    FrameId frameNo;
+    //Allocate a new buffer.  If buffer is full throws exception up stack
+    //before anything is allocated in the file
+    allocBuf(frameNo, file, Page::INVALID_NUMBER);
+    //Allocate an empty page right in the frame
+    try 
+    {
+      file -> allocatePage(bufPool[frameNo]);
+    } 
+    catch (...) 
+    {
+      releaseBuf(frameNo);
+      throw;
+    }
+    bufStats.allocs++;
+    pageNo = bufPool[frameNo].page_number();
 
-    bufDescTable[frameNo].Set(file, pageNo);
-    //Return pointer to buffer pool
-    page = & bufPool[frameNo];
+    BufDesc & desc = bufDescTable[frameNo];
+    {
+      std::lock_guard<std::mutex> latch(desc.latch);
+      desc.Set(file, pageNo);
+    }
+    bool published;
+    {
+      std::lock_guard<std::mutex> load(loadLatchOf(file));
+      published = publishFrame(file, pageNo, frameNo);
+    }
+    if (!published) 
+    {
+      // undo the allocation, in the frame and in the file
+      releaseBuf(frameNo);
+      file -> deletePage(pageNo);
+      throw HashAlreadyPresentException(file -> filename(), pageNo, frameNo);
+    }
+    policy -> frameLoaded(frameNo, file, pageNo);
 
     // ben
+    return frameNo;
   }
 
   void BufMgr::flushFile(const File * file)
   {
-    // Scans bufTable
-    for (FrameId i = 0; i < numBufs; i++) 
+    // pages read ahead after this point would stay behind in the pool
+    cancelPrefetch(file);
+    dropFrames(file);
+  }
+
+  void BufMgr::dropFrames(const File * file)
+  {
+    // write back the dirty pages in batches first, in page number order so
+    // File::writePages() can merge neighbours; the scan below then finds
+    // them clean, and handles pinned and invalid frames
+    std::vector<FrameId> batch;
+    File * owner = NULL;
+    for (const FrameId i : framesOf(file)) 
     {
-      if (bufDescTable[i].file == file) 
+      // the frame may have been reused for another file since framesOf()
+      File * pageFile;
+      if (!claimDirty(i, file, pageFile)) 
+      {
+        continue;
+      }
+      if (!batch.empty() && pageFile != owner) 
+      {
+        writeClaimed(owner, batch, false);
+        batch.clear();
+      }
+      owner = pageFile;
+      batch.push_back(i);
+      if (batch.size() == IO_BATCH) 
+      {
+        writeClaimed(owner, batch, false);
+        batch.clear();
+      }
+    }
+    if (!batch.empty()) 
+    {
+      writeClaimed(owner, batch, false);
+    }
+
+    // Scans the frames of the file
+    for (const FrameId i : framesOf(file)) 
+    {
+      BufDesc & desc = bufDescTable[i];
+      std::unique_lock<std::mutex> latch(desc.latch);
+      while (desc.ioInProgress) 
+      {
+        desc.ioDone.wait(latch);
+      }
+      if (desc.file == file) 
       {
         // If the page is pinned, throw PagePinnedException
-        if (bufDescTable[i].pinCnt > 0) 
+        if (desc.pinCnt > 0) 
         {
-          throw PagePinnedException(file -> filename(), bufDescTable[i].pageNo, i);
+          throw PagePinnedException(file -> filename(), desc.pageNo, i);
         }
         // If not a valid page throw BadBufferException
-        if (bufDescTable[i].valid == false) 
+        if (desc.valid == false) 
         {
-          throw BadBufferException(bufDescTable[i].frameNo, bufDescTable[i].dirty, bufDescTable[i].valid, bufDescTable[i].refbit);
+          throw BadBufferException(desc.frameNo, desc.dirty, desc.valid, desc.refbit);
         }
-        // File is dirty call file -> writePage() dirty bit is now false
-        if (bufDescTable[i].dirty == true) 
+        // File is dirty call file -> writePage() dirty bit is now false.
+        // Claim the frame the way claimDirty() does, so the write happens
+        // without the latch and readers of the page wait on ioDone instead.
+        if (desc.dirty == true) 
         {
-          bufDescTable[i].file -> writePage(bufPool[i]);
-          bufDescTable[i].dirty = false;
+          desc.ioInProgress = true;
+          File * pageFile = desc.file;
+          latch.unlock();
+          try 
+          {
+            pageFile -> writePage(bufPool[i]);
+          } 
+          catch (...) 
+          {
+            latch.lock();
+            desc.ioInProgress = false;
+            desc.ioDone.notify_all();
+            throw;
+          }
+          bufStats.diskwrites++;
+          latch.lock();
+          desc.dirty = false;
         }
         // Removes the page from hashtable
-        hashTable -> remove(file, bufDescTable[i].pageNo);
+        unpublishFrame(file, desc.pageNo, i);
         // Clears Description
-        bufDescTable[i].Clear();
+        desc.Clear();
+        desc.ioDone.notify_all();
+        latch.unlock();
+        freeBuf(i);
       }
     }
+    // the pages are on disk, so the file metadata describing them can follow
+    file -> flushMetadata();
   }
 
   void BufMgr::disposePage(File * file, const PageId PageNo) 
   {
     FrameId frameId;
-    try 
+    // Dipose page does nothing in the buffer pool if the page does not exist
+    if (lookupFrame(file, PageNo, frameId)) 
     {
-      hashTable -> lookup(file, PageNo, frameId);
-      // free frame in buffer pool
-      bufDescTable[frameId].Clear();
-      // remove from the hash table
-      hashTable -> remove(file, PageNo);
-    } catch (HashNotFoundException & e) 
-    {
-      // Dipose page does nothing if the page does not exist
+      BufDesc & desc = bufDescTable[frameId];
+      std::unique_lock<std::mutex> latch(desc.latch);
+      while (desc.ioInProgress) 
+      {
+        desc.ioDone.wait(latch);
+      }
+      if (desc.valid && desc.file == file && desc.pageNo == PageNo) 
+      {
+        // free frame in buffer pool
+        desc.Clear();
+        // remove from the hash table
+        unpublishFrame(file, PageNo, frameId);
+        latch.unlock();
+        freeBuf(frameId);
+      }
     }
     // delete the page from the file
     file -> deletePage(PageNo); 
@@ -272,4 +1406,67 @@ namespace badgerdb
 
     std::cout << "Total Number of Valid Frames:" << validFrames << "\n";
   }
+  //----------------------------------------
+  // PageHandle
+  //----------------------------------------
+
+  PageHandle::PageHandle(BufMgr * mgr, const FrameId frameNo, const File * file,
+                         const PageId pageNo)
+    : mgr(mgr), frameNo(frameNo), file(file), pageNumber(pageNo), dirty(false) 
+  {
+  }
+
+  PageHandle::PageHandle(PageHandle && other)
+    : mgr(other.mgr), frameNo(other.frameNo), file(other.file), pageNumber(other.pageNumber),
+      dirty(other.dirty) 
+  {
+    other.mgr = NULL;
+  }
+
+  PageHandle::~PageHandle() 
+  {
+    try 
+    {
+      release();
+    } 
+    catch (const PageNotPinnedException &) 
+    {
+      // destructors can't throw; call release() to find out
+    }
+  }
+
+  PageHandle & PageHandle::operator=(PageHandle && other) 
+  {
+    if (this != & other) 
+    {
+      release();
+      mgr = other.mgr;
+      frameNo = other.frameNo;
+      file = other.file;
+      pageNumber = other.pageNumber;
+      dirty = other.dirty;
+      other.mgr = NULL;
+    }
+    return *this;
+  }
+
+  Page * PageHandle::page() const 
+  {
+    return mgr == NULL ? NULL : & mgr -> bufPool[frameNo];
+  }
+
+  PageId PageHandle::pageNo() const 
+  {
+    return pageNumber;
+  }
+
+  void PageHandle::release() 
+  {
+    if (mgr != NULL) 
+    {
+      BufMgr * owner = mgr;
+      mgr = NULL;
+      owner -> unPinFrame(frameNo, file, pageNumber, dirty);
+    }
+  }
 }
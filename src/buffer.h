@@ -17,8 +17,21 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 #include "file.h"
 #include "bufHashTbl.h"
+#include "page_table.h"
+#include "replacement_policy.h"
 
 namespace badgerdb {
 
@@ -29,10 +42,15 @@ class BufMgr;
 
 /**
 * @brief Class for maintaining information about buffer pool frames
+*
+* file, pageNo, dirty, valid and ioInProgress are only read or written while
+* holding latch.  pinCnt is only changed while holding latch, but pinCnt and
+* refbit are atomic so the clock sweep can inspect them without latching.
 */
 class BufDesc {
 
 	friend class BufMgr;
+	friend class ClockPolicy;
 
  private:
 	/**
@@ -53,7 +71,7 @@ class BufDesc {
 	/**
    * Number of times this page has been pinned
 	 */
-  int pinCnt;
+  std::atomic<int> pinCnt;
 
 	/**
    * True if page is dirty;  false otherwise
@@ -68,7 +86,23 @@ class BufDesc {
 	/**
    * Has this buffer frame been reference recently
 	 */
-  bool refbit;
+  std::atomic<bool> refbit;
+
+	/**
+   * True while the page is being read from disk into this frame, or written
+   * out because the frame is being evicted
+	 */
+  bool ioInProgress;
+
+	/**
+   * Latch protecting the members of this descriptor
+	 */
+  std::mutex latch;
+
+	/**
+   * Signalled when ioInProgress is cleared
+	 */
+  std::condition_variable ioDone;
 
 	/**
    * Initialize buffer frame for a new user
@@ -81,6 +115,7 @@ class BufDesc {
     dirty = false;
     refbit = false;
 		valid = false;
+    ioInProgress = false;
   };
 
 	/**
@@ -132,26 +167,62 @@ class BufDesc {
 struct BufStats
 {
 	/**
-   * Total number of accesses to buffer pool
+   * Total number of accesses to buffer pool (calls to readPage)
+	 */
+  std::atomic<int> accesses;
+
+	/**
+   * Number of accesses that found the page already in the buffer pool
+	 */
+  std::atomic<int> hits;
+
+	/**
+   * Number of pages read from disk
 	 */
-  int accesses;
+  std::atomic<int> diskreads;
 
 	/**
-   * Number of pages read from disk (including allocs)
+   * Number of new pages allocated in files (calls to allocPage), which are
+   * set up in their frames without reading from disk
 	 */
-  int diskreads;
+  std::atomic<int> allocs;
 
 	/**
    * Number of pages written back to disk
 	 */
-  int diskwrites;
+  std::atomic<int> diskwrites;
+
+	/**
+   * Number of the diskwrites done by the background writer
+	 */
+  std::atomic<int> bgwrites;
+
+	/**
+   * Number of the diskreads done ahead of time by prefetch()
+	 */
+  std::atomic<int> prefetches;
+
+	/**
+   * Microseconds readPage() and allocPage() callers spent writing back dirty
+   * victims before they could reuse the frame
+	 */
+  std::atomic<std::uint64_t> stallMicros;
 
 	/**
    * Clear all values 
 	 */
   void clear()
   {
-		accesses = diskreads = diskwrites = 0;
+		accesses = hits = diskreads = allocs = diskwrites = bgwrites = prefetches = 0;
+		stallMicros = 0;
+  }
+
+	/**
+   * Fraction of accesses that were hits, or 0 if there were no accesses
+	 */
+  double hitRatio() const
+  {
+		return accesses == 0 ? 0.0 : (double)hits / accesses;
   }
       
 	/**
@@ -164,21 +235,262 @@ struct BufStats
 };
 
 
+/**
+* @brief Settings of the background writer of a BufMgr
+*
+* The watermarks are fractions of the unpinned pages in the buffer pool that
+* are dirty.  Once more than highWatermark of them are dirty the writer cleans
+* pages until at most lowWatermark are.
+*/
+struct BgWriterConfig
+{
+	/**
+   * Fraction of dirty unpinned pages at which the writer starts cleaning
+	 */
+  double highWatermark;
+
+	/**
+   * Fraction of dirty unpinned pages at which the writer stops cleaning
+	 */
+  double lowWatermark;
+
+	/**
+   * Maximum number of pages written per second, 0 for no limit
+	 */
+  std::uint32_t writesPerSecond;
+
+	/**
+   * Milliseconds the writer sleeps between checks of the buffer pool
+	 */
+  std::uint32_t intervalMillis;
+
+	/**
+   * Constructor of BgWriterConfig class, with the default settings
+	 */
+  BgWriterConfig()
+    : highWatermark(0.25), lowWatermark(0.1), writesPerSecond(0), intervalMillis(10)
+  {
+  }
+};
+
+
+/**
+* @brief Pin on a page in the buffer pool, released when the handle goes away
+*
+* Returned by the handle based readPage() and allocPage() of BufMgr.  The
+* handle remembers the frame holding the page, so unpinning it does not need
+* to look the page up again.  Handles can be moved but not copied; a
+* moved-from or released handle holds no page.
+*/
+class PageHandle
+{
+	friend class BufMgr;
+
+ public:
+	/**
+   * Constructs a handle holding no page
+	 */
+  PageHandle() : mgr(NULL), frameNo(0), file(NULL), pageNumber(Page::INVALID_NUMBER), dirty(false)
+  {
+  }
+
+	/**
+   * Takes over the pin of another handle
+	 */
+  PageHandle(PageHandle && other);
+
+	/**
+   * Unpins the page held so far, then takes over the pin of another handle
+	 */
+  PageHandle & operator=(PageHandle && other);
+
+  PageHandle(const PageHandle &) = delete;
+  PageHandle & operator=(const PageHandle &) = delete;
+
+	/**
+   * Destructor of PageHandle class, unpins the page.  A page that is no
+   * longer pinned, see release(), is ignored here.
+	 */
+  ~PageHandle();
+
+	/**
+   * Returns the page, or NULL if the handle holds no page
+	 */
+  Page* page() const;
+
+  Page* operator->() const
+  {
+		return page();
+  }
+
+  Page& operator*() const
+  {
+		return *page();
+  }
+
+	/**
+   * Returns the page number of the page held
+	 */
+  PageId pageNo() const;
+
+	/**
+   * Returns true if the handle holds a page
+	 */
+  explicit operator bool() const
+  {
+		return mgr != NULL;
+  }
+
+	/**
+   * Marks the page as dirty, so it is written back before being evicted
+	 */
+  void markDirty()
+  {
+		dirty = true;
+  }
+
+	/**
+   * Unpins the page now rather than when the handle is destroyed.  The
+   * handle holds no page afterwards, even if this throws.
+	 *
+   * @throws  PageNotPinnedException If the page was unpinned, e.g. by
+   *          unPinPage(), since the handle pinned it
+	 */
+  void release();
+
+ private:
+	/**
+   * Constructs a handle for a page BufMgr has already pinned
+	 */
+  PageHandle(BufMgr* mgr, const FrameId frameNo, const File* file, const PageId pageNo);
+
+	/**
+   * Buffer manager the page is pinned in, or NULL
+	 */
+  BufMgr* mgr;
+
+	/**
+   * Frame holding the page
+	 */
+  FrameId frameNo;
+
+	/**
+   * File of the page, to check the frame still holds it when unpinning
+	 */
+  const File* file;
+
+	/**
+   * Number of the page in its file
+	 */
+  PageId pageNumber;
+
+	/**
+   * True if the page must be unpinned as dirty
+	 */
+  bool dirty;
+};
+
+
+/**
+* @brief Small private ring of frames for a bulk scan
+*
+* Pages a scan reads through readPage(File*, const PageId, Page*&, BufferRing&)
+* that are not already in the buffer pool are read into the frames of the
+* ring, each frame being reused once the scan has gone around the ring.  This
+* keeps a large scan from evicting the rest of the pool.  A frame is only
+* reused if it still holds the page the scan put there and is unpinned;
+* otherwise the scan takes a new frame from the pool as usual.
+*
+* A ring belongs to one scan and must not be used by several threads at once.
+*/
+class BufferRing
+{
+	friend class BufMgr;
+
+ public:
+	/**
+   * Number of frames a ring holds by default
+	 */
+  static const std::uint32_t DEFAULT_SIZE = 16;
+
+	/**
+   * Constructor of BufferRing class
+	 *
+	 * @param size   	Number of frames in the ring, at least 1
+	 */
+  explicit BufferRing(const std::uint32_t size = DEFAULT_SIZE)
+    : slots(size == 0 ? 1 : size), next(0)
+  {
+  }
+
+ private:
+	/**
+   * A frame of the ring and the page the scan read into it
+	 */
+  struct Slot
+  {
+    Slot() : used(false) {}
+
+    bool used;
+    FrameId frame;
+    const File* file;
+    PageId pageNo;
+  };
+
+	/**
+   * Frames of the ring
+	 */
+  std::vector<Slot> slots;
+
+	/**
+   * Index of the slot the next page is read into
+	 */
+  std::uint32_t next;
+};
+
+
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+*
+* readPage(), unPinPage(), allocPage(), flushFile() and disposePage() may be
+* called concurrently from multiple threads.  Two threads missing on the same
+* page share a single read from disk.
+*
+* An optional background writer, see startBackgroundWriter(), writes back
+* dirty unpinned pages ahead of eviction so that callers rarely have to.
 */
 class BufMgr 
 {
+	friend class PageHandle;
+
  private:
 	/**
-   * Current position of clockhand in our buffer pool
+   * Claims victims offered by the replacement policy
 	 */
-  FrameId clockHand;
+  class FrameClaim;
 
 	/**
    * Number of frames in the buffer pool
 	 */
-  std::uint32_t numBufs;
+  std::atomic<std::uint32_t> numBufs;
+
+	/**
+   * Most frames the pool can grow to, given to the constructor; address space
+   * for this many frames and descriptors is reserved up front, so frames
+   * never move
+	 */
+  std::uint32_t maxBufs;
+
+	/**
+   * Number of frames whose memory has been made usable and whose page and
+   * descriptor have been constructed; at least numBufs
+	 */
+  std::uint32_t builtBufs;
+
+	/**
+   * Serializes resize()
+	 */
+  std::mutex resizeLatch;
 	
 	/**
    * Hash table mapping (File, page) to frame
@@ -190,34 +502,534 @@ class BufMgr
 	 */
   BufDesc *bufDescTable;
 
+	/**
+   * Frames of the pages in the hash table, per file and in page number
+   * order, so flushing a file visits only its own frames and writes its
+   * pages in the order they are laid out on disk
+	 */
+  std::unordered_map<const File*, std::map<PageId, FrameId> > fileFrames;
+
+	/**
+   * Protects fileFrames
+	 */
+  std::mutex fileFramesLatch;
+
+	/**
+	 * Adds a page just inserted into the hash table to fileFrames.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frame   	Frame holding the page
+	 */
+  void indexFrame(const File* file, const PageId pageNo, const FrameId frame);
+
+	/**
+	 * Removes a page just removed from the hash table from fileFrames, unless
+	 * the page has meanwhile been published in another frame.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frame   	Frame that held the page
+	 */
+  void unindexFrame(const File* file, const PageId pageNo, const FrameId frame);
+
+	/**
+	 * Returns the frames of the pages of a file, in page number order.
+	 *
+	 * @param file   	File object
+	 * @return  			Frames in fileFrames for the file.
+	 */
+  std::vector<FrameId> framesOf(const File* file);
+
 	/**
    * Maintains Buffer pool usage statistics 
 	 */
   BufStats bufStats;
 
 	/**
-   * Advance clock to next frame in the buffer pool
+   * Size of a transparent huge page, which the buffer pool is aligned to
+   * when huge pages are requested
+	 */
+  static const std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+	/**
+   * Times the initial size the pool may grow to unless the constructor is
+   * given a maximum, see maxBufs
+	 */
+  static const std::uint32_t DEFAULT_GROWTH_FACTOR = 4;
+
+	/**
+   * Bytes mapped for bufPool
+	 */
+  std::size_t poolBytes;
+
+	/**
+   * Bytes mapped for bufDescTable
+	 */
+  std::size_t descBytes;
+
+	/**
+   * Reserves the address space of bufPool and bufDescTable for maxBufs
+   * frames, then builds the first numBufs frames.
+	 *
+	 * @param hugePages  Align the pool for and advise transparent huge pages
+	 * @throws std::bad_alloc If the memory can't be mapped
+	 */
+  void mapPool(const bool hugePages);
+
+	/**
+   * Makes the memory of the frames below bufs usable and constructs their
+   * pages and descriptors, unless that has already been done.
+	 *
+	 * @param bufs  Number of frames needed
+	 * @throws std::bad_alloc If the memory can't be committed
+	 */
+  void buildFrames(const std::uint32_t bufs);
+
+	/**
+   * Shrinks the pool, see resize().
+	 *
+	 * @param bufs  New number of frames, less than numBufs
+	 * @return  False if a frame that would be dropped is pinned or busy.
+	 */
+  bool shrink(const std::uint32_t bufs);
+
+	/**
+   * Decides which frame to evict when no frame is free
+	 */
+  ReplacementPolicy *policy;
+
+	/**
+   * Frames not holding any page
+	 */
+  std::vector<FrameId> freeFrames;
+
+	/**
+   * Protects freeFrames
+	 */
+  std::mutex freeLatch;
+
+	/**
+   * Settings of the background writer
+	 */
+  BgWriterConfig bgConfig;
+
+	/**
+   * Background writer thread, if one was started
+	 */
+  std::thread bgWriter;
+
+	/**
+   * True while the background writer should keep running
+	 */
+  std::atomic<bool> bgRunning;
+
+	/**
+   * Protects bgRunning changes so the writer can wait on bgWake, and the
+   * pass counters below
+	 */
+  std::mutex bgMutex;
+
+	/**
+   * Wakes the background writer early, e.g. after a caller had to write
+   * back a victim itself
+	 */
+  std::condition_variable bgWake;
+
+	/**
+   * Number of passes over the pool the background writer has finished
+	 */
+  std::uint64_t bgPasses;
+
+	/**
+   * True if the last finished pass found the pool below the high watermark
+	 */
+  bool bgLastPassIdle;
+
+	/**
+   * Signals the end of each pass of the background writer
+	 */
+  std::condition_variable bgPassDone;
+
+	/**
+   * Most pages read or written back in one batch by the prefetcher, the
+   * background writer and flushFile()
+	 */
+  static const std::uint32_t IO_BATCH = 32;
+
+	/**
+   * Most frames allocBuf() looks at for a clean victim, among those the
+   * policy would evict next, before it settles for a dirty one
+	 */
+  static const std::uint32_t CLEAN_VICTIM_WINDOW = 16;
+
+	/**
+   * A page queued by prefetch()
+	 */
+  struct PrefetchRequest
+  {
+    File* file;
+    PageId pageNo;
+  };
+
+	/**
+   * Thread reading queued pages, started by the first prefetch()
+	 */
+  std::thread prefetcher;
+
+	/**
+   * False once the prefetcher should exit
+	 */
+  bool prefetchRunning;
+
+	/**
+   * Pages waiting to be read by the prefetcher
+	 */
+  std::deque<PrefetchRequest> prefetchQueue;
+
+	/**
+   * File the prefetcher is reading a page of, or NULL
+	 */
+  const File* prefetchCurrent;
+
+	/**
+   * Protects the prefetcher state above
+	 */
+  std::mutex prefetchMutex;
+
+	/**
+   * Signals new prefetch requests and the end of each prefetched read
+	 */
+  std::condition_variable prefetchWake;
+
+	/**
+   * Main loop of the prefetcher thread
+	 */
+  void prefetcherLoop();
+
+	/**
+	 * Drops a queued prefetch of the page, if any.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 */
+  void dropPrefetch(const File* file, const PageId pageNo);
+
+	/**
+	 * Drops queued prefetches of the file and waits until the prefetcher is
+	 * no longer reading one of its pages.
+	 *
+	 * @param file   	File object
+	 */
+  void cancelPrefetch(const File* file);
+
+	/**
+   * Most files that can have a page table at once
+	 */
+  static const int MAX_PAGE_TABLES = 8;
+
+	/**
+   * A file translated through its own PageTable rather than the hash table.
+   * Never changes once published, so a lookup reads the file and its table
+   * with a single load of the slot.
+	 */
+  struct FilePageTable
+  {
+    /**
+     * File of the table
+     */
+    const File* file;
+
+    /**
+     * Table of the file
+     */
+    PageTable table;
+
+    FilePageTable(const File* file, const PageId numPages): file(file), table(numPages)
+    {
+    }
+  };
+
+	/**
+   * Page tables enabled by enablePageTable(), NULL for unused slots; only
+   * the first numPageTables slots have ever been used
+	 */
+  std::atomic<FilePageTable*> pageTables[MAX_PAGE_TABLES];
+
+	/**
+   * Number of slots of pageTables that have ever been used
+	 */
+  std::atomic<int> numPageTables;
+
+	/**
+   * Tables removed by disablePageTable().  Lookups that started before may
+   * still be using them, so they are only freed with the BufMgr.
+	 */
+  std::vector<FilePageTable*> retiredPageTables;
+
+	/**
+   * Serializes enabling and disabling page tables, and protects
+   * retiredPageTables
+	 */
+  std::mutex pageTablesLatch;
+
+	/**
+   * Number of latches loads are striped over, see loadLatchOf()
+	 */
+  static const int NUM_LOAD_LATCHES = 16;
+
+	/**
+   * Held while publishing a newly loaded or allocated page of a file, and by
+   * enablePageTable() and disablePageTable() while they move the file, so no
+   * page of it can be published in the structure being left behind
+	 */
+  std::mutex loadLatches[NUM_LOAD_LATCHES];
+
+	/**
+	 * Returns the latch serializing loads of the file's pages with page
+	 * table changes of the file.
+	 *
+	 * @param file   	File object
+	 */
+  std::mutex& loadLatchOf(const File* file)
+  {
+    return loadLatches[(reinterpret_cast<std::uintptr_t>(file) / sizeof(void*)) % NUM_LOAD_LATCHES];
+  }
+
+	/**
+	 * Writes back and drops every frame of the file, then its metadata; the
+	 * body of flushFile() without cancelling prefetches.
+	 *
+	 * @param file   	File object
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool
+   * @throws BadBufferException If any frame allocated to the file is found to be invalid
+	 */
+  void dropFrames(const File* file);
+
+	/**
+	 * Returns the page table of a file, or NULL if it uses the hash table.
+	 *
+	 * @param file   	File object
+	 */
+  PageTable* pageTableOf(const File* file) const;
+
+	/**
+	 * Looks up the frame of a page in the file's page table or the hash table.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frame   	Set to the frame of the page if it is found
+	 * @return  			True if the page is in the pool.
+	 */
+  bool lookupFrame(const File* file, const PageId pageNo, FrameId & frame);
+
+	/**
+	 * Adds a page to the file's page table or the hash table, and to fileFrames.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frame   	Frame holding the page
+	 * @return  			False if the page is already in the pool.
+	 */
+  bool publishFrame(const File* file, const PageId pageNo, const FrameId frame);
+
+	/**
+	 * Removes a page from the file's page table or the hash table, and from
+	 * fileFrames, if it is present.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frame   	Frame that held the page
+	 */
+  void unpublishFrame(const File* file, const PageId pageNo, const FrameId frame);
+
+	/**
+	 * Implements the public readPage() overloads: pins the page, reading it
+	 * in if needed.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param ring  	Ring of frames of the scan, or NULL
+	 * @return  			Frame holding the pinned page.
+	 */
+  FrameId pinPage(File* file, const PageId PageNo, BufferRing* ring);
+
+	/**
+	 * Implements the public allocPage() overloads.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number assigned to the new page
+	 * @return  			Frame holding the new, pinned page.
+	 */
+  FrameId newPage(File* file, PageId & PageNo);
+
+	/**
+	 * Unpins the page in a frame the caller believes it has pinned, without
+	 * looking the page up.  Used by PageHandle.
+	 *
+	 * @param frameNo Frame holding the page
+	 * @param file   	File of the page
+	 * @param pageNo  Number of the page
+	 * @param dirty		True if the page needs to be marked dirty
+	 * @throws  PageNotPinnedException If the frame no longer holds the page or the page is not pinned
+	 */
+  void unPinFrame(const FrameId frameNo, const File* file, const PageId pageNo, const bool dirty);
+
+	/**
+	 * Reads a page that was not found in the hash table into a new frame.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frame   	Frame the page was read into
+	 * @param pin   	Whether to leave the page pinned once it has been read
+	 * @param ring   	Ring to read the page into, or NULL to use the whole pool
+	 * @return  			False if another thread started reading the page first.
+	 * @throws BufferExceededException If no frame can be allocated
+	 */
+  bool loadBuf(File* file, const PageId pageNo, FrameId & frame, const bool pin,
+               BufferRing* ring = NULL);
+
+	/**
+	 * First half of loadBuf(): allocates a frame for the page and publishes
+	 * it in the hash table as being read.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frame   	Frame the page is to be read into
+	 * @param ring   	Ring to read the page into, or NULL to use the whole pool
+	 * @param batched True if the caller already holds the file's load latch
+	 * @return  			False if another thread started reading the page first.
+	 * @throws BufferExceededException If no frame can be allocated
+	 */
+  bool startLoad(File* file, const PageId pageNo, FrameId & frame, BufferRing* ring,
+                 const bool batched = false);
+
+	/**
+	 * Second half of loadBuf(), once the page has been read into the frame:
+	 * makes the page valid and wakes threads waiting for it.
+	 *
+	 * @param frame   	Frame passed to startLoad()
+	 * @param pin   	Whether to leave the page pinned
+	 * @param ring   	Ring passed to startLoad()
+	 */
+  void finishLoad(const FrameId frame, const bool pin, BufferRing* ring);
+
+	/**
+	 * Undoes startLoad() after the page could not be read.
+	 *
+	 * @param frame   	Frame passed to startLoad()
+	 */
+  void abortLoad(const FrameId frame);
+
+	/**
+	 * Reads the pages of a file that are not in the pool yet, unpinned, with
+	 * one batched read.  Pages that don't exist are skipped, and so are pages
+	 * no frame can be allocated for.
+	 *
+	 * @param file   	File object
+	 * @param pageNos  Page numbers in the file
+	 */
+  void loadBatch(File* file, const std::vector<PageId> & pageNos);
+
+	/**
+	 * Takes back a frame of a ring for the next page of its scan, if the frame
+	 * still holds the page the scan read into it and nobody is using it.  On
+	 * success the frame is cleared and reserved as allocBuf() describes.
+	 *
+	 * @param slot   	Slot of the ring to reuse
+	 * @return  			True if the frame was taken back.
+	 */
+  bool reclaimBuf(const BufferRing::Slot & slot);
+
+	/**
+   * Main loop of the background writer thread
+	 */
+  void bgWriterLoop();
+
+	/**
+	 * Claims the page in a frame for writing back if it is valid, dirty,
+	 * unpinned, has no I/O in progress and, unless expected is NULL, belongs
+	 * to expected.  All of this is checked under the frame's latch, so the
+	 * frame can't be reused for another file in between.  Readers of the page
+	 * wait until writeClaimed() is done with it.
+	 *
+	 * @param frame   	Frame to clean
+	 * @param expected  File the page has to belong to, or NULL for any file
+	 * @param file   	Set to the file of the page if it was claimed
+	 * @return  			True if the page was claimed.
+	 */
+  bool claimDirty(const FrameId frame, const File* expected, File* & file);
+
+	/**
+	 * Writes back the pages claimed by claimDirty() in one batch and releases
+	 * the frames.  If the write fails the pages stay dirty.
+	 *
+	 * @param file   	File all of the pages belong to
+	 * @param frames  Claimed frames
+	 * @param background  Whether to count the writes as done by the background writer
+	 * @return  			Number of pages written, either all or none.
 	 */
-  void advanceClock();
+  std::uint32_t writeClaimed(File* file, const std::vector<FrameId> & frames,
+                             const bool background);
 
 	/**
-	 * Allocate a free frame.  
+	 * Allocate a free frame.  The frame is returned cleared but with a pin
+	 * count of one, so no other thread can allocate it until the caller either
+	 * assigns it to a page or clears it again.
 	 *
 	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param file   	File of the page that will be placed in the frame
+	 * @param pageNo  Page number of the page that will be placed in the frame
 	 * @throws BufferExceededException If no such buffer is found which can be allocated
 	 */
-  void allocBuf(FrameId & frame);
+  void allocBuf(FrameId & frame, const File* file, const PageId pageNo);
+
+	/**
+	 * Writes back and drops the page in a frame claimed through FrameClaim,
+	 * leaving the frame cleared and reserved as allocBuf() describes.
+	 *
+	 * @param frame   	Claimed frame
+	 */
+  void evict(const FrameId frame);
+
+	/**
+	 * Releases a frame returned by allocBuf() that ended up not being used.
+	 *
+	 * @param frame   	Frame to release
+	 */
+  void releaseBuf(const FrameId frame);
+
+	/**
+	 * Returns a frame whose page was dropped (and its descriptor cleared) to
+	 * the free frames, telling the replacement policy it is gone.
+	 *
+	 * @param frame   	Frame to free
+	 */
+  void freeBuf(const FrameId frame);
 
  public:
 	/**
-   * Actual buffer pool from which frames are allocated
+   * Actual buffer pool from which frames are allocated.  The frames are one
+   * contiguous, page aligned array of Page::SIZE byte pages, so pages of
+   * FileBackend::DIRECT files move between frames and disk without copies.
 	 */
   Page* bufPool;
 
 	/**
-   * Constructor of BufMgr class
+   * Constructor of BufMgr class.  The memory of the buffer pool is reserved
+   * but not touched, so frames only cost memory once they are first used.
+	 *
+	 * @param bufs   	Number of frames in the buffer pool
+	 * @param policyType  Page replacement policy to use
+	 * @param hugePages  Ask the kernel to back the buffer pool with
+	 *                   transparent huge pages
+	 * @param maxPoolBufs  Most frames resize() may grow the pool to, or 0 for
+	 *                     four times bufs; address space is reserved for as many
 	 */
-  BufMgr(std::uint32_t bufs);
+  BufMgr(std::uint32_t bufs,
+         const ReplacementPolicyType policyType = ReplacementPolicyType::CLOCK,
+         const bool hugePages = false,
+         const std::uint32_t maxPoolBufs = 0);
 	
 	/**
    * Destructor of BufMgr class
@@ -235,6 +1047,67 @@ class BufMgr
 	 */
   void readPage(File* file, const PageId PageNo, Page*& page);
 
+	/**
+	 * Reads the given page like readPage(File*, const PageId, Page*&), but
+	 * if the page is not in the buffer pool it is read into a frame of the
+	 * scan's ring rather than one chosen by the replacement policy.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+	 * @param ring  	Ring of frames of the scan
+	 */
+  void readPage(File* file, const PageId PageNo, Page*& page, BufferRing& ring);
+
+	/**
+	 * Reads the given page like readPage(File*, const PageId, Page*&) and
+	 * returns a handle that unpins it when destroyed.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @return  			Handle pinning the page.
+	 */
+  PageHandle readPage(File* file, const PageId PageNo);
+
+	/**
+	 * Reads the given page like readPage(File*, const PageId, Page*&, BufferRing&)
+	 * and returns a handle that unpins it when destroyed.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param ring  	Ring of frames of the scan
+	 * @return  			Handle pinning the page.
+	 */
+  PageHandle readPage(File* file, const PageId PageNo, BufferRing& ring);
+
+	/**
+	 * Schedules pages to be read into the buffer pool in the background, so
+	 * that later readPage() calls for them are hits.  Prefetched pages are not
+	 * pinned.  A readPage() of a page that is still being prefetched waits for
+	 * that read instead of issuing its own.  Pages already in the pool, pages
+	 * that do not exist and pages for which no frame is free are skipped.
+	 *
+	 * @param file   	File object
+	 * @param first  	First page number to read
+	 * @param count  	Number of consecutive page numbers to read
+	 */
+  void prefetch(File* file, const PageId first, const PageId count);
+
+	/**
+	 * Schedules the given pages to be read in the background, in order.  See
+	 * prefetch(File*, const PageId, const PageId).
+	 *
+	 * @param file   	File object
+	 * @param pageNos Page numbers to read
+	 */
+  void prefetch(File* file, const std::vector<PageId> & pageNos);
+
+	/**
+	 * Waits until every page queued by prefetch() so far has been read, or
+	 * dropped.
+	 */
+  void waitForPrefetches();
+
 	/**
 	 * Unpin a page from memory since it is no longer required for it to remain in memory.
 	 *
@@ -256,8 +1129,21 @@ class BufMgr
   void allocPage(File* file, PageId &PageNo, Page*& page); 
 
 	/**
-	 * Writes out all dirty pages of the file to disk.
+	 * Allocates a new, empty page in the file like allocPage(File*, PageId&, Page*&)
+	 * and returns a handle that unpins it when destroyed.
+	 *
+	 * @param file   	File object
+	 * @return  			Handle pinning the new page; its page number is PageHandle::pageNo().
+	 */
+  PageHandle allocPage(File* file);
+
+	/**
+	 * Writes out all dirty pages of the file to disk, in page number order
+	 * with runs of consecutive pages written together; see File::writePages().
+	 * Only the frames of the file are visited.
 	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
+	 * Pages of the file queued by prefetch() and not read yet are dropped.
+	 * The file's header and maps are written after its pages, see File::flushMetadata().
 	 * Otherwise Error returned.
 	 *
 	 * @param file   	File object
@@ -266,6 +1152,67 @@ class BufMgr
 	 */
   void flushFile(const File* file);
 
+	/**
+	 * Grows or shrinks the buffer pool while it is in use.  Growing adds
+	 * empty frames.  Shrinking writes back and drops the pages in the frames
+	 * past the new size; it fails, leaving the pool as it was, if any of
+	 * those frames is pinned or has I/O in progress, or a page can't be
+	 * written back.  A failed shrink only drops pages if a frame was pinned
+	 * while it was under way.  Pages of the remaining frames stay cached
+	 * either way.  Frames never move, so pointers to pinned pages stay valid.
+	 *
+	 * @param bufs   	New number of frames, between 1 and the maximum given to
+	 * 								the constructor
+	 * @return  			True if the pool now has bufs frames.
+	 * @throws std::bad_alloc If memory for new frames can't be committed
+	 */
+  bool resize(const std::uint32_t bufs);
+
+	/**
+	 * Resizes the pool to the most frames that fit in the given memory,
+	 * counting each frame's page and descriptor.  Meant to be called from a
+	 * memory limit callback, e.g. when the limit of the container changes.
+	 *
+	 * @param bytes   Memory the pool may use
+	 * @return  			True if the pool was resized, see resize().
+	 */
+  bool setMemoryLimit(const std::uint64_t bytes);
+
+	/**
+	 * Returns the current number of frames in the buffer pool.
+	 */
+  std::uint32_t poolSize() const
+  {
+    return numBufs;
+  }
+
+	/**
+	 * Translates the pages of the file to frames through a dense per file
+	 * PageTable instead of the hash table.  The table is sized for the
+	 * file's current pages and grows as pages are allocated, so this suits
+	 * small, hot files; large files with few pages in the pool are better
+	 * off in the hash table.  The pages of the file are flushed first, see
+	 * flushFile().  Other threads may keep using the file: loads of its
+	 * pages wait until the switch is done, and a page they pin before the
+	 * flush reaches it makes this throw.
+	 *
+	 * @param file   	File object
+	 * @return  			False if MAX_PAGE_TABLES files already have a page table.
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool
+	 */
+  bool enablePageTable(File* file);
+
+	/**
+	 * Moves the file back to the hash table after enablePageTable().  The
+	 * pages of the file are flushed first, as by enablePageTable().  The
+	 * table's memory is kept until the BufMgr is destroyed, as lookups
+	 * running meanwhile may still be reading it.
+	 *
+	 * @param file   	File object
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool
+	 */
+  void disablePageTable(File* file);
+
 	/**
 	 * Delete page from file and also from buffer pool if present.
 	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
@@ -281,6 +1228,35 @@ class BufMgr
   void  printSelf();
 
 	/**
+	 * Starts a thread that writes back dirty unpinned pages in the background,
+	 * so that eviction can pick clean victims.  A writer that is already
+	 * running is stopped and restarted with the new settings.
+	 *
+	 * @param config  Watermarks and write rate of the writer
+	 */
+  void startBackgroundWriter(const BgWriterConfig & config = BgWriterConfig());
+
+	/**
+	 * Stops the background writer, if running, and waits for it to exit.
+	 */
+  void stopBackgroundWriter();
+
+	/**
+	 * Waits until a pass of the background writer that started after this
+	 * call finds nothing to clean, i.e. no more dirty unpinned pages than its
+	 * high watermark allows.  Returns at once if no writer is running.
+	 */
+  void waitForBackgroundWriter();
+
+	/**
+   * Name of the page replacement policy in use
+	 */
+  const char* policyName() const
+  {
+		return policy -> name();
+  }
+
+	/**
    * Get buffer pool usage statistics
 	 */
   BufStats & getBufStats()
@@ -0,0 +1,83 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "clock_policy.h"
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+ClockPolicy::ClockPolicy(BufDesc* bufDescTable, const std::uint32_t numBufs)
+    : bufDescTable(bufDescTable),
+      numBufs(numBufs),
+      clockHand(numBufs - 1) {
+}
+
+void ClockPolicy::frameLoaded(const FrameId frame, const File* file,
+                              const PageId pageNo) {
+  bufDescTable[frame].refbit = true;
+}
+
+void ClockPolicy::frameAccessed(const FrameId frame) {
+  bufDescTable[frame].refbit = true;
+}
+
+void ClockPolicy::resize(const std::uint32_t numBufs) {
+  // a hand past the end wraps around on its next move
+  this->numBufs = numBufs;
+}
+
+FrameId ClockPolicy::advanceClock() {
+  const std::uint32_t bufs = numBufs;
+  FrameId hand = clockHand.load();
+  while (!clockHand.compare_exchange_weak(hand, (hand + 1) % bufs)) {
+  }
+  return (hand + 1) % bufs;
+}
+
+bool ClockPolicy::pickVictim(const File* file, const PageId pageNo,
+                             VictimCheck& check, FrameId& frame) {
+  // count loops; if 2 loops around the clock complete, then
+  // all frames must have pinned pages
+  for (std::uint32_t cntLoops = 0; cntLoops < 2 * numBufs; cntLoops++) {
+    const FrameId hand = advanceClock();
+    BufDesc& curr = bufDescTable[hand];
+    if (curr.pinCnt > 0 || curr.refbit) {
+      // give recently used and pinned frames another round
+      curr.refbit = false;
+      continue;
+    }
+    if (check.tryClaim(hand)) {
+      frame = hand;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ClockPolicy::probeVictim(const File* file, const PageId pageNo,
+                              VictimCheck& check, const std::uint32_t window,
+                              FrameId& frame) {
+  // look ahead of the hand without moving it or clearing refbits, so frames
+  // passed over keep their second chance for the next real sweep
+  const std::uint32_t bufs = numBufs;
+  const FrameId hand = clockHand;
+  for (std::uint32_t i = 1; i <= window && i <= bufs; i++) {
+    const FrameId candidate = (hand + i) % bufs;
+    const BufDesc& curr = bufDescTable[candidate];
+    if (curr.pinCnt > 0 || curr.refbit) {
+      continue;
+    }
+    if (check.tryClaim(candidate)) {
+      frame = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+}
@@ -0,0 +1,74 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Single reference bit clock replacement.
+ *
+ * Uses the refbit and pinCnt of each BufDesc directly.  Accesses only set an
+ * atomic bit, so hits never take a latch, and the sweep may run while other
+ * threads hit.
+ */
+class ClockPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructs a clock over the given frames.
+   *
+   * @param bufDescTable  Descriptors of the buffer pool frames
+   * @param numBufs       Number of frames in the buffer pool
+   */
+  ClockPolicy(BufDesc* bufDescTable, const std::uint32_t numBufs);
+
+  const char* name() const override { return "CLOCK"; }
+
+  void frameLoaded(const FrameId frame, const File* file,
+                   const PageId pageNo) override;
+
+  void frameAccessed(const FrameId frame) override;
+
+  void frameFreed(const FrameId frame) override {}
+
+  void resize(const std::uint32_t numBufs) override;
+
+  bool pickVictim(const File* file, const PageId pageNo,
+                  VictimCheck& check, FrameId& frame) override;
+
+  bool probeVictim(const File* file, const PageId pageNo, VictimCheck& check,
+                   const std::uint32_t window, FrameId& frame) override;
+
+ private:
+  /**
+   * Advance clock to next frame in the buffer pool
+   *
+   * @return  Frame the clock hand now points to
+   */
+  FrameId advanceClock();
+
+  /**
+   * Descriptors of the buffer pool frames
+   */
+  BufDesc* bufDescTable;
+
+  /**
+   * Number of frames in the buffer pool
+   */
+  std::atomic<std::uint32_t> numBufs;
+
+  /**
+   * Current position of clockhand in our buffer pool
+   */
+  std::atomic<FrameId> clockHand;
+};
+
+}
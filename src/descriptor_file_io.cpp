@@ -0,0 +1,242 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "descriptor_file_io.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "exceptions/file_io_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Buffer aligned for O_DIRECT transfers, freed when it goes out of scope.
+ */
+class BounceBuffer {
+ public:
+  explicit BounceBuffer(const std::size_t length) : data_(NULL) {
+    if (::posix_memalign(reinterpret_cast<void**>(&data_),
+                         FileIO::DIRECT_ALIGNMENT, length) != 0) {
+      throw std::bad_alloc();
+    }
+  }
+
+  ~BounceBuffer() { std::free(data_); }
+
+  char* data() { return data_; }
+
+ private:
+  BounceBuffer(const BounceBuffer&);
+  BounceBuffer& operator=(const BounceBuffer&);
+
+  char* data_;
+};
+
+/**
+ * Rounds an offset down to a multiple of FileIO::DIRECT_ALIGNMENT.
+ */
+std::uint64_t alignDown(const std::uint64_t offset) {
+  return offset - offset % FileIO::DIRECT_ALIGNMENT;
+}
+
+/**
+ * Rounds an offset up to a multiple of FileIO::DIRECT_ALIGNMENT.
+ */
+std::uint64_t alignUp(const std::uint64_t offset) {
+  return alignDown(offset + FileIO::DIRECT_ALIGNMENT - 1);
+}
+
+}
+
+DescriptorFileIO::DescriptorFileIO(const std::string& filename,
+                                   const bool truncate, const bool direct)
+    : FileIO(filename),
+      direct_(direct) {
+  int flags = O_RDWR | O_CREAT;
+  if (truncate) {
+    flags |= O_TRUNC;
+  }
+  if (direct_) {
+    flags |= O_DIRECT;
+  }
+  fd_ = ::open(filename_.c_str(), flags, 0644);
+  if (fd_ < 0) {
+    throw FileIOException(filename_, "open", errno);
+  }
+  ring_.reset(IoUringEngine::create());
+}
+
+DescriptorFileIO::~DescriptorFileIO() {
+  ::close(fd_);
+}
+
+std::size_t DescriptorFileIO::readAt(char* buffer, const std::size_t length,
+                                     const std::uint64_t offset) {
+  if (!direct_ || directAligned(buffer, length, offset)) {
+    return readFully(buffer, length, offset);
+  }
+  const std::uint64_t start = alignDown(offset);
+  const std::size_t span = alignUp(offset + length) - start;
+  BounceBuffer bounce(span);
+  const std::size_t count = readFully(bounce.data(), span, start);
+  const std::size_t skip = offset - start;
+  if (count <= skip) {
+    return 0;
+  }
+  const std::size_t done = std::min(length, count - skip);
+  std::memcpy(buffer, bounce.data() + skip, done);
+  return done;
+}
+
+void DescriptorFileIO::writeAt(const char* buffer, const std::size_t length,
+                               const std::uint64_t offset) {
+  if (!direct_ || directAligned(buffer, length, offset)) {
+    writeFully(buffer, length, offset);
+    return;
+  }
+  // Read the blocks the bytes fall into, patch them and write them back.
+  // Bytes past the end of the file are zeros, so the file may grow to the
+  // end of the last block.
+  const std::uint64_t start = alignDown(offset);
+  const std::size_t span = alignUp(offset + length) - start;
+  BounceBuffer bounce(span);
+  std::lock_guard<std::mutex> guard(bounce_latch_);
+  const std::size_t count = readFully(bounce.data(), span, start);
+  std::memset(bounce.data() + count, 0, span - count);
+  std::memcpy(bounce.data() + (offset - start), buffer, length);
+  writeFully(bounce.data(), span, start);
+}
+
+std::size_t DescriptorFileIO::readFully(char* buffer, const std::size_t length,
+                                        const std::uint64_t offset) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t count = ::pread(fd_, buffer + done, length - done,
+                                  offset + done);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename_, "read", errno);
+    }
+    if (count == 0) {
+      // End of file.
+      break;
+    }
+    done += count;
+  }
+  return done;
+}
+
+void DescriptorFileIO::writeFully(const char* buffer, const std::size_t length,
+                                  const std::uint64_t offset) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t count = ::pwrite(fd_, buffer + done, length - done,
+                                   offset + done);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename_, "write", errno);
+    }
+    done += count;
+  }
+}
+
+void DescriptorFileIO::writeVectored(const char* const* buffers,
+                                     const std::size_t count,
+                                     const std::size_t length,
+                                     const std::uint64_t offset) {
+  bool aligned = true;
+  for (std::size_t i = 0; direct_ && aligned && i < count; ++i) {
+    aligned = directAligned(buffers[i], length, offset + i * length);
+  }
+  if (!aligned) {
+    // Misaligned direct transfers need the bounce buffers of writeAt().
+    FileIO::writeVectored(buffers, count, length, offset);
+    return;
+  }
+  std::vector<iovec> iovecs(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    // pwritev() doesn't change the buffers.
+    iovecs[i].iov_base = const_cast<char*>(buffers[i]);
+    iovecs[i].iov_len = length;
+  }
+  std::size_t first = 0;
+  std::uint64_t position = offset;
+  while (first < count) {
+    const int segments = std::min<std::size_t>(count - first, IOV_MAX);
+    const ssize_t written = ::pwritev(fd_, &iovecs[first], segments,
+                                      position);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename_, "write", errno);
+    }
+    // Skip the buffers written completely and trim a partly written one.
+    position += written;
+    std::size_t remaining = written;
+    while (first < count && remaining >= iovecs[first].iov_len) {
+      remaining -= iovecs[first].iov_len;
+      ++first;
+    }
+    if (remaining > 0) {
+      iovecs[first].iov_base =
+          static_cast<char*>(iovecs[first].iov_base) + remaining;
+      iovecs[first].iov_len -= remaining;
+    }
+  }
+}
+
+void DescriptorFileIO::sync() {
+  if (::fdatasync(fd_) != 0) {
+    throw FileIOException(filename_, "sync", errno);
+  }
+}
+
+void DescriptorFileIO::advise(const AccessPattern pattern) {
+  int advice = POSIX_FADV_NORMAL;
+  if (pattern == AccessPattern::SEQUENTIAL) {
+    advice = POSIX_FADV_SEQUENTIAL;
+  } else if (pattern == AccessPattern::RANDOM) {
+    advice = POSIX_FADV_RANDOM;
+  }
+  ::posix_fadvise(fd_, 0, 0, advice);
+}
+
+void DescriptorFileIO::submit(IoRequest* requests, const std::size_t count) {
+  bool aligned = true;
+  for (std::size_t i = 0; direct_ && aligned && i < count; ++i) {
+    aligned = directAligned(requests[i].buffer, requests[i].length,
+                            requests[i].offset);
+  }
+  if (!ring_ || !aligned) {
+    // Misaligned direct transfers need the bounce buffers of readAt() and
+    // writeAt().
+    FileIO::submit(requests, count);
+    return;
+  }
+  const int error = ring_->submit(fd_, requests, count);
+  if (error != 0) {
+    throw FileIOException(filename_, "transfer", error);
+  }
+}
+
+}
@@ -0,0 +1,114 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "file_io.h"
+#include "io_uring_engine.h"
+
+namespace badgerdb {
+
+/**
+ * @brief FileIO on a file descriptor using pread() and pwrite().
+ *
+ * Positional reads and writes don't share a file position, so no latch is
+ * needed and threads can access the file concurrently.  Batches passed to
+ * submit() run through an IoUringEngine when the kernel supports io_uring,
+ * and one request at a time otherwise.
+ *
+ * The same class implements the DIRECT backend.  Misaligned transfers are
+ * widened to the surrounding aligned blocks in a bounce buffer; a misaligned
+ * write reads those blocks, changes them and writes them back under a
+ * latch, so it must not race with writes to the same blocks.  File only does
+ * misaligned transfers for its header and map pages, which it writes under
+ * its metadata latch.
+ */
+class DescriptorFileIO : public FileIO {
+ public:
+  /**
+   * Opens the file.
+   *
+   * @param filename  Name of the file.
+   * @param truncate  Whether to discard the existing contents of the file.
+   * @param direct    Whether to bypass the page cache with O_DIRECT.
+   * @throws  FileIOException   If the file can't be opened, e.g. because the
+   *                            file system doesn't support O_DIRECT.
+   */
+  DescriptorFileIO(const std::string& filename, const bool truncate,
+                   const bool direct);
+
+  /**
+   * Closes the file descriptor.
+   */
+  ~DescriptorFileIO();
+
+  FileBackend backend() const override {
+    return direct_ ? FileBackend::DIRECT : FileBackend::DESCRIPTOR;
+  }
+
+  std::size_t readAt(char* buffer, const std::size_t length,
+                     const std::uint64_t offset) override;
+
+  void writeAt(const char* buffer, const std::size_t length,
+               const std::uint64_t offset) override;
+
+  /**
+   * Uses pwritev(), so the buffers go to disk as one transfer.
+   */
+  void writeVectored(const char* const* buffers, const std::size_t count,
+                     const std::size_t length,
+                     const std::uint64_t offset) override;
+
+  void sync() override;
+
+  void advise(const AccessPattern pattern) override;
+
+  void submit(IoRequest* requests, const std::size_t count) override;
+
+  bool asynchronous() const override { return ring_.get() != NULL; }
+
+ private:
+  /**
+   * Reads with pread() until length bytes are read or the file ends.
+   *
+   * @return  Number of bytes read.
+   */
+  std::size_t readFully(char* buffer, const std::size_t length,
+                        const std::uint64_t offset);
+
+  /**
+   * Writes with pwrite() until all length bytes are written.
+   */
+  void writeFully(const char* buffer, const std::size_t length,
+                  const std::uint64_t offset);
+
+  /**
+   * Whether the file was opened with O_DIRECT.
+   */
+  const bool direct_;
+
+  /**
+   * Serializes the read-modify-write of misaligned writes in DIRECT mode.
+   */
+  std::mutex bounce_latch_;
+
+  /**
+   * Descriptor of the open file.
+   */
+  int fd_;
+
+  /**
+   * Engine for batches, or NULL if io_uring is unavailable.
+   */
+  std::unique_ptr<IoUringEngine> ring_;
+};
+
+}
@@ -11,27 +11,63 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <cassert>
+#include <cerrno>
 
 #include "exceptions/file_exists_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
+#include "exceptions/invalid_file_format_exception.h"
 #include "exceptions/invalid_page_exception.h"
 #include "file_iterator.h"
 #include "page.h"
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
+namespace {
+
+/**
+ * Header of a version 1 file, at the start of page 0.
+ */
+struct LegacyFileHeader {
+  PageId num_pages;
+  PageId first_used_page;
+  PageId num_free_pages;
+  PageId first_free_page;
+};
+
+/**
+ * Page header fields a version 1 file chains its used and free pages with,
+ * at this offset in each page.
+ */
+struct LegacyPageLink {
+  PageId current_page_number;
+  PageId next_page_number;
+};
+
+const std::size_t LEGACY_PAGE_LINK_OFFSET = 8;
+
+static_assert(sizeof(LegacyFileHeader) == 16 && sizeof(LegacyPageLink) == 8,
+              "Legacy structures must match the old on-disk layout.");
+
+}
+
+File::FileIOMap File::open_files_;
 File::CountMap File::open_counts_;
+File::MetadataMap File::open_metadata_;
 
-File File::create(const std::string& filename) {
-  return File(filename, true /* create_new */);
+File File::create(const std::string& filename, const FileBackend backend,
+                  const std::uint64_t growth_room) {
+  return File(filename, true /* create_new */, backend, growth_room);
 }
 
-File File::open(const std::string& filename) {
-  return File(filename, false /* create_new */);
+File File::open(const std::string& filename, const FileBackend backend,
+                const std::uint64_t growth_room) {
+  return File(filename, false /* create_new */, backend, growth_room);
 }
 
 void File::remove(const std::string& filename) {
@@ -44,6 +80,144 @@ void File::remove(const std::string& filename) {
   std::remove(filename.c_str());
 }
 
+void File::convert(const std::string& filename) {
+  if (!exists(filename)) {
+    throw FileNotFoundException(filename);
+  }
+  if (isOpen(filename)) {
+    throw FileOpenException(filename);
+  }
+  std::unique_ptr<FileIO> in(
+      FileIO::open(filename, FileBackend::STREAM, false /* truncate */));
+  char old_page[Page::SIZE] = {};
+  FileHeader header;
+  if (in->readAt(old_page, Page::SIZE, pagePosition(0)) <
+      sizeof(LegacyFileHeader)) {
+    throw InvalidFileFormatException(filename);
+  }
+  std::memcpy(&header, old_page, sizeof(header));
+  // Version 1 files have no magic number; later ones start with it.
+  const std::uint32_t old_version =
+      header.magic == MAGIC ? header.version : OLDEST_CONVERTIBLE_VERSION;
+  if ((header.magic == MAGIC && header.version <= OLDEST_CONVERTIBLE_VERSION) ||
+      old_version > FORMAT_VERSION) {
+    throw InvalidFileFormatException(filename);
+  }
+  if (old_version == FORMAT_VERSION) {
+    return;
+  }
+
+  const std::string converted_name = filename + ".convert";
+  try {
+    std::unique_ptr<FileIO> out(FileIO::open(
+        converted_name, FileBackend::STREAM, true /* truncate */));
+    if (old_version == OLDEST_CONVERTIBLE_VERSION) {
+      convertBaseline(filename, *in, *out);
+    } else {
+      // Map pages, including the header page, keep their layout.
+      header.version = FORMAT_VERSION;
+      std::memcpy(old_page, &header, sizeof(header));
+      out->writeAt(old_page, Page::SIZE, pagePosition(0));
+      Page page((Page::NoInit()));
+      for (PageId page_number = 1; page_number < header.num_pages;
+           ++page_number) {
+        const std::size_t length =
+            in->readAt(old_page, Page::SIZE, pagePosition(page_number));
+        if (isMapPage(page_number)) {
+          // The map of the last group may not have been written yet.
+          std::memset(old_page + length, 0, Page::SIZE - length);
+          out->writeAt(old_page, Page::SIZE, pagePosition(page_number));
+          continue;
+        }
+        if (length != Page::SIZE || !page.convertFrom(old_page, old_version)) {
+          throw InvalidFileFormatException(filename);
+        }
+        out->writeAt(reinterpret_cast<const char*>(&page), Page::SIZE,
+                     pagePosition(page_number));
+      }
+    }
+    out->sync();
+  } catch (...) {
+    std::remove(converted_name.c_str());
+    throw;
+  }
+  in.reset();
+  if (std::rename(converted_name.c_str(), filename.c_str()) != 0) {
+    const int error = errno;
+    std::remove(converted_name.c_str());
+    throw FileIOException(filename, "rename", error);
+  }
+}
+
+void File::convertBaseline(const std::string& filename, FileIO& in,
+                           FileIO& out) {
+  LegacyFileHeader old_header;
+  in.readAt(reinterpret_cast<char*>(&old_header), sizeof(old_header),
+            pagePosition(0));
+  if (old_header.num_pages == 0 || old_header.num_pages > PAGES_PER_MAP) {
+    throw InvalidFileFormatException(filename);
+  }
+
+  // Follow both page lists; each page but the header page has to be on
+  // exactly one of them.
+  enum PageState { UNLISTED, USED, FREE };
+  std::vector<PageState> states(old_header.num_pages, UNLISTED);
+  const PageId firsts[] = {old_header.first_used_page,
+                           old_header.first_free_page};
+  const PageState list_states[] = {USED, FREE};
+  PageId num_free_pages = 0;
+  for (int list = 0; list < 2; ++list) {
+    for (PageId page_number = firsts[list];
+         page_number != Page::INVALID_NUMBER;) {
+      LegacyPageLink link;
+      if (page_number >= old_header.num_pages ||
+          states[page_number] != UNLISTED ||
+          in.readAt(reinterpret_cast<char*>(&link), sizeof(link),
+                    pagePosition(page_number) + LEGACY_PAGE_LINK_OFFSET) !=
+              sizeof(link) ||
+          (list_states[list] == USED &&
+           link.current_page_number != page_number)) {
+        throw InvalidFileFormatException(filename);
+      }
+      states[page_number] = list_states[list];
+      if (list_states[list] == FREE) {
+        ++num_free_pages;
+      }
+      page_number = link.next_page_number;
+    }
+  }
+  if (num_free_pages != old_header.num_free_pages ||
+      std::count(states.begin() + 1, states.end(), UNLISTED) != 0) {
+    throw InvalidFileFormatException(filename);
+  }
+
+  char map_page[Page::SIZE] = {};
+  const FileHeader header = {MAGIC, FORMAT_VERSION, old_header.num_pages,
+                             old_header.num_free_pages, 0};
+  std::memcpy(map_page, &header, sizeof(header));
+  char old_page[Page::SIZE];
+  Page page((Page::NoInit()));
+  const Page free_page;
+  for (PageId page_number = 1; page_number < old_header.num_pages;
+       ++page_number) {
+    if (states[page_number] == FREE) {
+      out.writeAt(reinterpret_cast<const char*>(&free_page), Page::SIZE,
+                  pagePosition(page_number));
+      continue;
+    }
+    if (in.readAt(old_page, Page::SIZE, pagePosition(page_number)) !=
+            Page::SIZE ||
+        !page.convertFrom(old_page, OLDEST_CONVERTIBLE_VERSION) ||
+        page.page_number() != page_number) {
+      throw InvalidFileFormatException(filename);
+    }
+    out.writeAt(reinterpret_cast<const char*>(&page), Page::SIZE,
+                pagePosition(page_number));
+    map_page[MAP_OFFSET + page_number / 8] |= 1 << (page_number % 8);
+  }
+  out.writeAt(map_page, Page::SIZE, pagePosition(0));
+}
+
 bool File::isOpen(const std::string& filename) {
   if (!exists(filename)) {
     return false;
@@ -64,16 +238,19 @@ bool File::exists(const std::string& filename) {
 
 File::File(const File& other)
   : filename_(other.filename_),
-    stream_(open_streams_[filename_]) {
+    io_(open_files_[filename_]),
+    metadata_(open_metadata_[filename_]) {
   ++open_counts_[filename_];
 }
 
 File& File::operator=(const File& rhs) {
   // This accounts for self-assignment and assignment of a File object for the
   // same file.
+  const FileBackend backend = rhs.backend();
   close();	//close my file and associate me with the new one
   filename_ = rhs.filename_;
-  openIfNeeded(false /* create_new */);
+  // rhs keeps the file open, so it is never reopened here.
+  openIfNeeded(false /* create_new */, backend, FileIO::DEFAULT_GROWTH_ROOM);
   return *this;
 }
 
@@ -82,223 +259,469 @@ File::~File() {
 }
 
 Page File::allocatePage() {
-  FileHeader header = readHeader();
-  Page new_page;
-  Page existing_page;
-  if (header.num_free_pages > 0) {
-    new_page = readPage(header.first_free_page, true /* allow_free */);
-    new_page.set_page_number(header.first_free_page);
-    header.first_free_page = new_page.next_page_number();
-    --header.num_free_pages;
-
-    if (header.first_used_page == Page::INVALID_NUMBER ||
-        header.first_used_page > new_page.page_number()) {
-      // Either have no pages used or the head of the used list is a page later
-      // than the one we just allocated, so add the new page to the head.
-      if (header.first_used_page > new_page.page_number()) {
-        new_page.set_next_page_number(header.first_used_page);
-      }
-      header.first_used_page = new_page.page_number();
-    } else {
-      // New page is reused from somewhere after the beginning, so we need to
-      // find where in the used list to insert it.
-      PageId next_page_number = Page::INVALID_NUMBER;
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
-            next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      existing_page.set_next_page_number(new_page.page_number());
-      new_page.set_next_page_number(next_page_number);
-    }
+  // allocatePage(Page&) initializes the page.
+  Page new_page((Page::NoInit()));
+  allocatePage(new_page);
+  return new_page;
+}
 
-    assert((header.num_free_pages == 0) ==
-           (header.first_free_page == Page::INVALID_NUMBER));
-  } else {
-    new_page.set_page_number(header.num_pages);
-    if (header.first_used_page == Page::INVALID_NUMBER) {
-      header.first_used_page = new_page.page_number();
+void File::allocatePage(Page& new_page) {
+  if (io_->backend() == FileBackend::MMAP_READ_ONLY) {
+    // Fail before the metadata changes, as it could never be written back.
+    throw FileIOException(filename_, "write", EBADF);
+  }
+  PageId page_number;
+  {
+    // Take the page number and count the page as used right away, so other
+    // threads allocating meanwhile get different pages.
+    std::lock_guard<std::mutex> guard(metadata_->latch);
+    FileHeader& header = metadata_->header;
+    if (header.num_free_pages > 0) {
+      page_number = findFreePage();
+      --header.num_free_pages;
     } else {
-      // If we have pages allocated, we need to add the new page to the tail
-      // of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
+      // Append at the tail of the file, skipping the map page if the tail is
+      // at a group boundary.  The map page is written by flushMetadata().
+      page_number = header.num_pages;
+      if (isMapPage(page_number)) {
+        metadata_->maps.push_back(
+            std::vector<unsigned char>(PAGES_PER_MAP / 8));
+        metadata_->dirty_maps.push_back(true);
+        ++page_number;
       }
-      assert(existing_page.isUsed());
-      existing_page.set_next_page_number(new_page.page_number());
+      header.num_pages = page_number + 1;
     }
-    ++header.num_pages;
+    metadata_->header_dirty = true;
+    setPageUsed(page_number, true);
+    ++metadata_->pending_allocations;
   }
-  writePage(new_page.page_number(), new_page);
-  if (existing_page.page_number() != Page::INVALID_NUMBER) {
-    // If we updated an existing page by inserting the new page into the
-    // used list, we need to write it out.
-    writePage(existing_page.page_number(), existing_page);
+  new_page.initialize();
+  new_page.set_page_number(page_number);
+  try {
+    writePage(page_number, new_page);
+  } catch (...) {
+    finishAllocation(page_number, false /* written */);
+    throw;
   }
-  writeHeader(header);
+  finishAllocation(page_number, true /* written */);
+}
 
-  return new_page;
+void File::finishAllocation(const PageId page_number, const bool written) {
+  std::lock_guard<std::mutex> guard(metadata_->latch);
+  if (!written) {
+    // Give the page back as a free page; pages appended after it may
+    // already be in use, so the tail can't simply be moved back.
+    FileHeader& header = metadata_->header;
+    setPageUsed(page_number, false);
+    ++header.num_free_pages;
+    if (mapGroup(page_number) < header.free_search_group) {
+      header.free_search_group = mapGroup(page_number);
+    }
+  }
+  if (--metadata_->pending_allocations == 0) {
+    metadata_->allocations_done.notify_all();
+  }
 }
 
 Page File::readPage(const PageId page_number) const {
-  FileHeader header = readHeader();
-  if (page_number >= header.num_pages) {
-    throw InvalidPageException(page_number, filename_);
-  }
-  return readPage(page_number, false /* allow_free */);
+  // Every byte is overwritten by the read.
+  Page page((Page::NoInit()));
+  readPage(page_number, page, false /* allow_free */);
+  return page;
+}
+
+void File::readPage(const PageId page_number, Page& page) const {
+  readPage(page_number, page, false /* allow_free */);
 }
 
 Page File::readPage(const PageId page_number, const bool allow_free) const {
-  Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(page.header_));
-  stream_->read(&page.data_[0], Page::DATA_SIZE);
+  // Every byte is overwritten by the read.
+  Page page((Page::NoInit()));
+  readPage(page_number, page, allow_free);
+  return page;
+}
+
+void File::readPage(const PageId page_number, Page& page,
+                    const bool allow_free) const {
+  if (page_number == Page::INVALID_NUMBER || isMapPage(page_number)) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  // Header and data are laid out in a Page exactly as on disk, so the whole
+  // page is read in one go.
+  if (io_->readAt(reinterpret_cast<char*>(&page), Page::SIZE,
+                  pagePosition(page_number)) != Page::SIZE) {
+    // Past the end of the file.
+    throw InvalidPageException(page_number, filename_);
+  }
+  ++metadata_->page_reads;
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
+}
 
-  return page;
+void File::readPages(const PageId* page_numbers, Page* const* pages,
+                     const std::size_t count, bool* valid) const {
+  std::vector<IoRequest> requests;
+  std::vector<std::size_t> indexes;
+  requests.reserve(count);
+  indexes.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    if (page_numbers[i] == Page::INVALID_NUMBER ||
+        isMapPage(page_numbers[i])) {
+      if (valid == NULL) {
+        throw InvalidPageException(page_numbers[i], filename_);
+      }
+      valid[i] = false;
+      continue;
+    }
+    const IoRequest request = {false /* write */,
+                               reinterpret_cast<char*>(pages[i]), Page::SIZE,
+                               pagePosition(page_numbers[i]), 0 /* done */};
+    requests.push_back(request);
+    indexes.push_back(i);
+  }
+  io_->submit(requests.data(), requests.size());
+  for (std::size_t r = 0; r < requests.size(); ++r) {
+    const std::size_t i = indexes[r];
+    const bool ok = requests[r].done == Page::SIZE && pages[i]->isUsed();
+    if (ok) {
+      ++metadata_->page_reads;
+    } else if (valid == NULL) {
+      throw InvalidPageException(page_numbers[i], filename_);
+    }
+    if (valid != NULL) {
+      valid[i] = ok;
+    }
+  }
+}
+
+void File::writePages(const Page* const* pages, const std::size_t count) {
+  std::vector<const Page*> sorted(pages, pages + count);
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const Page* lhs, const Page* rhs) {
+                     return lhs->page_number() < rhs->page_number();
+                   });
+  std::vector<IoRequest> requests;
+  std::vector<const char*> run;
+  {
+    std::lock_guard<std::mutex> guard(metadata_->latch);
+    for (const Page* page : sorted) {
+      const PageId page_number = page->page_number();
+      if (page_number == Page::INVALID_NUMBER ||
+          page_number >= metadata_->header.num_pages ||
+          isMapPage(page_number) || !isPageUsed(page_number)) {
+        throw InvalidPageException(page_number, filename_);
+      }
+    }
+  }
+  // Consecutive pages are adjacent on disk; a map page between two pages
+  // has a number of its own, so it ends the run.
+  for (std::size_t i = 0; i < count; ++i) {
+    run.push_back(reinterpret_cast<const char*>(sorted[i]));
+    const PageId first = sorted[i + 1 - run.size()]->page_number();
+    if (i + 1 < count && sorted[i + 1]->page_number() == first + run.size()) {
+      continue;
+    }
+    if (run.size() > 1) {
+      io_->writeVectored(run.data(), run.size(), Page::SIZE,
+                         pagePosition(first));
+    } else {
+      // Writes don't change the buffer.
+      const IoRequest request = {true /* write */,
+                                 const_cast<char*>(run.front()), Page::SIZE,
+                                 pagePosition(first), 0 /* done */};
+      requests.push_back(request);
+    }
+    run.clear();
+  }
+  io_->submit(requests.data(), requests.size());
+  metadata_->page_writes += count;
+}
+
+const Page& File::viewPage(const PageId page_number) const {
+  const char* mapping = io_->mapping();
+  if (mapping == NULL) {
+    throw FileIOException(filename_, "view", ENOTSUP);
+  }
+  {
+    std::lock_guard<std::mutex> guard(metadata_->latch);
+    if (page_number == Page::INVALID_NUMBER ||
+        page_number >= metadata_->header.num_pages ||
+        isMapPage(page_number) || !isPageUsed(page_number)) {
+      throw InvalidPageException(page_number, filename_);
+    }
+  }
+  return *reinterpret_cast<const Page*>(mapping + pagePosition(page_number));
 }
 
 void File::writePage(const Page& new_page) {
-  PageHeader header = readPageHeader(new_page.page_number());
-  if (header.current_page_number == Page::INVALID_NUMBER) {
-    // Page has been deleted since it was read.
-    throw InvalidPageException(new_page.page_number(), filename_);
+  const PageId page_number = new_page.page_number();
+  {
+    std::lock_guard<std::mutex> guard(metadata_->latch);
+    if (page_number == Page::INVALID_NUMBER ||
+        page_number >= metadata_->header.num_pages ||
+        isMapPage(page_number) || !isPageUsed(page_number)) {
+      // Page has been deleted since it was read.
+      throw InvalidPageException(page_number, filename_);
+    }
   }
-  // Page on disk may have had its next page pointer updated since it was read;
-  // we don't modify that, but we do keep all the other modifications to the
-  // page header.
-  const PageId next_page_number = header.next_page_number;
-  header = new_page.header_;
-  header.next_page_number = next_page_number;
-  writePage(new_page.page_number(), header, new_page);
+  writePage(page_number, new_page);
 }
 
 void File::deletePage(const PageId page_number) {
-  FileHeader header = readHeader();
-  Page existing_page = readPage(page_number);
-  Page previous_page;
-  // If this page is the head of the used list, update the header to point to
-  // the next page in line.
-  if (page_number == header.first_used_page) {
-    header.first_used_page = existing_page.next_page_number();
-  } else {
-    // Walk the used list so we can update the page that points to this one.
-    for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
+  {
+    std::lock_guard<std::mutex> guard(metadata_->latch);
+    const FileHeader& header = metadata_->header;
+    if (page_number == Page::INVALID_NUMBER || page_number >= header.num_pages ||
+        isMapPage(page_number) || !isPageUsed(page_number)) {
+      throw InvalidPageException(page_number, filename_);
+    }
+  }
+  // Clear the page so it reads back as free.  It stays marked used meanwhile,
+  // so it can't be allocated again before it is cleared.
+  Page existing_page;
+  writePage(page_number, existing_page);
+  std::lock_guard<std::mutex> guard(metadata_->latch);
+  if (!isPageUsed(page_number)) {
+    // Another delete of the page finished first.
+    throw InvalidPageException(page_number, filename_);
+  }
+  FileHeader& header = metadata_->header;
+  setPageUsed(page_number, false);
+  ++header.num_free_pages;
+  if (mapGroup(page_number) < header.free_search_group) {
+    header.free_search_group = mapGroup(page_number);
+  }
+  metadata_->header_dirty = true;
+}
+
+void File::flushMetadata() const {
+  std::unique_lock<std::mutex> guard(metadata_->latch);
+  // Pages are written before the maps that count them.
+  metadata_->allocations_done.wait(
+      guard, [this] { return metadata_->pending_allocations == 0; });
+  for (std::size_t group = 0; group < metadata_->maps.size(); ++group) {
+    if (metadata_->dirty_maps[group]) {
+      io_->writeAt(reinterpret_cast<const char*>(&metadata_->maps[group][0]),
+                   PAGES_PER_MAP / 8, mapBytePosition(group * PAGES_PER_MAP));
+      ++metadata_->metadata_writes;
+      metadata_->dirty_maps[group] = false;
+    }
+  }
+  if (metadata_->header_dirty) {
+    writeHeader(metadata_->header);
+    metadata_->header_dirty = false;
+  }
+}
+
+void File::sync() {
+  io_->sync();
+  flushMetadata();
+  io_->sync();
+}
+
+void File::adviseAccess(const AccessPattern pattern) {
+  io_->advise(pattern);
+}
+
+PageId File::numPages() const {
+  std::lock_guard<std::mutex> guard(metadata_->latch);
+  return metadata_->header.num_pages;
+}
+
+FileStats File::stats() const {
+  FileStats stats;
+  stats.page_reads = metadata_->page_reads;
+  stats.page_writes = metadata_->page_writes;
+  stats.metadata_reads = metadata_->metadata_reads;
+  stats.metadata_writes = metadata_->metadata_writes;
+  return stats;
+}
+
+void File::clearStats() {
+  metadata_->page_reads = 0;
+  metadata_->page_writes = 0;
+  metadata_->metadata_reads = 0;
+  metadata_->metadata_writes = 0;
+}
+
+PageId File::findFreePage() {
+  FileHeader& header = metadata_->header;
+  for (PageId group = header.free_search_group; ; ++group) {
+    assert(group < metadata_->maps.size());
+    const std::vector<unsigned char>& bitmap = metadata_->maps[group];
+    // Bit 0 stands for the map page itself, which is never used.
+    for (PageId bit = 1; bit < PAGES_PER_MAP; ++bit) {
+      const PageId page_number = group * PAGES_PER_MAP + bit;
+      if (page_number >= header.num_pages) {
         break;
       }
+      if ((bitmap[bit / 8] & (1 << (bit % 8))) == 0) {
+        // Groups before this one are full, so later searches start here.
+        header.free_search_group = group;
+        return page_number;
+      }
     }
   }
-  // Clear the page and add it to the head of the free list.
-  existing_page.initialize();
-  existing_page.set_next_page_number(header.first_free_page);
-  header.first_free_page = page_number;
-  ++header.num_free_pages;
-  if (previous_page.isUsed()) {
-    writePage(previous_page.page_number(), previous_page);
+}
+
+bool File::isPageUsed(const PageId page_number) const {
+  const PageId bit = page_number % PAGES_PER_MAP;
+  return (metadata_->maps[mapGroup(page_number)][bit / 8] &
+          (1 << (bit % 8))) != 0;
+}
+
+void File::setPageUsed(const PageId page_number, const bool used) {
+  const PageId group = mapGroup(page_number);
+  const PageId bit = page_number % PAGES_PER_MAP;
+  unsigned char& byte = metadata_->maps[group][bit / 8];
+  if (used) {
+    byte |= 1 << (bit % 8);
+  } else {
+    byte &= ~(1 << (bit % 8));
   }
-  writePage(page_number, existing_page);
-  writeHeader(header);
+  metadata_->dirty_maps[group] = true;
+}
+
+PageId File::nextUsedPage(const PageId page_number) const {
+  std::lock_guard<std::mutex> guard(metadata_->latch);
+  // Map pages are never marked used, so they are skipped too.
+  for (PageId next = page_number + 1; next < metadata_->header.num_pages;
+       ++next) {
+    if (isPageUsed(next)) {
+      return next;
+    }
+  }
+  return Page::INVALID_NUMBER;
 }
 
 FileIterator File::begin() {
-  const FileHeader& header = readHeader();
-  return FileIterator(this, header.first_used_page);
+  return FileIterator(this, nextUsedPage(Page::INVALID_NUMBER));
 }
 
 FileIterator File::end() {
   return FileIterator(this, Page::INVALID_NUMBER);
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
-  openIfNeeded(create_new);
+File::File(const std::string& name, const bool create_new,
+           const FileBackend backend, const std::uint64_t growth_room)
+    : filename_(name) {
+  openIfNeeded(create_new, backend, growth_room);
+
+  if (open_counts_[filename_] == 1) {
+    // Just opened or created.
+    try {
+      loadMetadata(create_new);
+    } catch (...) {
+      close();
+      throw;
+    }
+  }
+}
 
+void File::loadMetadata(const bool create_new) {
+  FileHeader& header = metadata_->header;
   if (create_new) {
-    // File starts with 1 page (the header).
-    FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
-    writeHeader(header);
+    // File starts with 1 page (the header and the first map), padded so that
+    // all pages are aligned to Page::SIZE.
+    header.magic = MAGIC;
+    header.version = FORMAT_VERSION;
+    header.num_pages = 1;
+    header.num_free_pages = 0;
+    header.free_search_group = 0;
+    char header_page[Page::SIZE] = {};
+    std::memcpy(header_page, &header, sizeof(header));
+    io_->writeAt(header_page, Page::SIZE, pagePosition(0));
+    ++metadata_->metadata_writes;
+  } else {
+    // Make sure it is a file we understand.
+    header = readHeader();
+    if (header.magic != MAGIC || header.version != FORMAT_VERSION) {
+      throw InvalidFileFormatException(filename_);
+    }
+  }
+  const PageId num_groups = (header.num_pages - 1) / PAGES_PER_MAP + 1;
+  metadata_->maps.assign(num_groups,
+                         std::vector<unsigned char>(PAGES_PER_MAP / 8));
+  metadata_->dirty_maps.assign(num_groups, false);
+  if (!create_new) {
+    for (PageId group = 0; group < num_groups; ++group) {
+      // Bytes past the end of the file are left 0.
+      io_->readAt(reinterpret_cast<char*>(&metadata_->maps[group][0]),
+                  PAGES_PER_MAP / 8, mapBytePosition(group * PAGES_PER_MAP));
+      ++metadata_->metadata_reads;
+    }
   }
 }
 
-void File::openIfNeeded(const bool create_new) {
+void File::openIfNeeded(const bool create_new, const FileBackend backend,
+                        const std::uint64_t growth_room) {
   if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
     ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+    io_ = open_files_[filename_];
+    metadata_ = open_metadata_[filename_];
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
     const bool already_exists = exists(filename_);
     if (create_new) {
       // Error if we try to overwrite an existing file.
       if (already_exists) {
         throw FileExistsException(filename_);
       }
-      // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
     } else {
       // Error if we try to open a file that doesn't exist.
       if (!already_exists) {
         throw FileNotFoundException(filename_);
       }
+      // Files of older format versions are brought up to date first; a
+      // read-only file is left alone and rejected by loadMetadata().
+      if (backend != FileBackend::MMAP_READ_ONLY) {
+        convert(filename_);
+      }
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
+    // New files have to be truncated on open.
+    io_.reset(FileIO::open(filename_, backend, create_new /* truncate */,
+                           growth_room));
+    open_files_[filename_] = io_;
+    metadata_ = std::make_shared<FileMetadata>();
+    open_metadata_[filename_] = metadata_;
     open_counts_[filename_] = 1;
   }
 }
 
 void File::close() {
+  if (io_ && open_counts_[filename_] == 1) {
+    // Last one out writes back the metadata.
+    flushMetadata();
+  }
   --open_counts_[filename_];
-  stream_.reset();
+  io_.reset();
+  metadata_.reset();
   if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
+    open_files_.erase(filename_);
     open_counts_.erase(filename_);
+    open_metadata_.erase(filename_);
   }
 }
 
 void File::writePage(const PageId page_number, const Page& new_page) {
-  writePage(page_number, new_page.header_, new_page);
-}
-
-void File::writePage(const PageId page_number, const PageHeader& header,
-                     const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->write(&new_page.data_[0], Page::DATA_SIZE);
-  stream_->flush();
+  // The page is laid out as on disk, so it is written in one go.
+  io_->writeAt(reinterpret_cast<const char*>(&new_page), Page::SIZE,
+               pagePosition(page_number));
+  ++metadata_->page_writes;
 }
 
 FileHeader File::readHeader() const {
   FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+  io_->readAt(reinterpret_cast<char*>(&header), sizeof(header), 0 /* pos */);
+  ++metadata_->metadata_reads;
 
   return header;
 }
 
-void File::writeHeader(const FileHeader& header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->flush();
-}
-
-PageHeader File::readPageHeader(PageId page_number) const {
-  PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
-
-  return header;
+void File::writeHeader(const FileHeader& header) const {
+  io_->writeAt(reinterpret_cast<const char*>(&header), sizeof(header),
+               0 /* pos */);
+  ++metadata_->metadata_writes;
 }
 
 }
@@ -7,11 +7,16 @@
 
 #pragma once
 
-#include <fstream>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
+#include "file_io.h"
 #include "page.h"
 
 namespace badgerdb {
@@ -23,14 +28,20 @@ class FileIterator;
  */
 struct FileHeader {
   /**
-   * Number of pages allocated in the file.
+   * Always File::MAGIC; identifies BadgerDB files.
    */
-  PageId num_pages;
+  std::uint32_t magic;
+
+  /**
+   * On-disk format version the file was written with.
+   */
+  std::uint32_t version;
 
   /**
-   * Page number of the first used page in the file.
+   * Number of pages allocated in the file, including the header and map
+   * pages.  New pages are appended at this page number.
    */
-  PageId first_used_page;
+  PageId num_pages;
 
   /**
    * Number of free pages (allocated but unused) in the file.
@@ -38,9 +49,10 @@ struct FileHeader {
   PageId num_free_pages;
 
   /**
-   * Page number of the first free (allocated but unused) page in the file.
+   * Lowest map group that may have a free page; all groups before it are
+   * full.
    */
-  PageId first_free_page;
+  PageId free_search_group;
 
   /**
    * Returns true if this file header is equal to the other.
@@ -49,10 +61,103 @@ struct FileHeader {
    * @return  True if the other header is equal to this one.
    */
   bool operator==(const FileHeader& rhs) const {
-    return num_pages == rhs.num_pages &&
+    return magic == rhs.magic &&
+        version == rhs.version &&
+        num_pages == rhs.num_pages &&
         num_free_pages == rhs.num_free_pages &&
-        first_used_page == rhs.first_used_page &&
-        first_free_page == rhs.first_free_page;
+        free_search_group == rhs.free_search_group;
+  }
+};
+
+/**
+ * @brief Counts of the I/O done on a file, kept across all File objects
+ *        referring to it.
+ */
+struct FileStats {
+  /**
+   * Number of pages read.
+   */
+  std::uint64_t page_reads;
+
+  /**
+   * Number of pages written, including deleted pages being cleared.
+   */
+  std::uint64_t page_writes;
+
+  /**
+   * Number of reads of the file header or of map pages.
+   */
+  std::uint64_t metadata_reads;
+
+  /**
+   * Number of writes of the file header or of map pages.
+   */
+  std::uint64_t metadata_writes;
+};
+
+/**
+ * @brief In-memory copy of the header and map pages of an open file.
+ *
+ * One FileMetadata is shared by all File objects referring to the same file.
+ * Pages are allocated and deleted in memory only; the changes reach the disk
+ * when File::flushMetadata() is called.
+ */
+struct FileMetadata {
+  /**
+   * Held while reading or changing the members below.
+   */
+  std::mutex latch;
+
+  /**
+   * Current header of the file.
+   */
+  FileHeader header;
+
+  /**
+   * Whether header differs from the header on disk.
+   */
+  bool header_dirty;
+
+  /**
+   * Bitmap of every map page, indexed by group.
+   */
+  std::vector<std::vector<unsigned char> > maps;
+
+  /**
+   * Whether each bitmap in maps differs from the one on disk.
+   */
+  std::vector<bool> dirty_maps;
+
+  /**
+   * Number of pages counted as used in header and maps whose first write is
+   * still in progress.  The latch is not held across that write.
+   */
+  std::uint32_t pending_allocations;
+
+  /**
+   * Signalled when pending_allocations drops to 0.
+   */
+  std::condition_variable allocations_done;
+
+  /**
+   * Counters reported by File::stats().
+   */
+  std::atomic<std::uint64_t> page_reads;
+  std::atomic<std::uint64_t> page_writes;
+  std::atomic<std::uint64_t> metadata_reads;
+  std::atomic<std::uint64_t> metadata_writes;
+
+  /**
+   * Constructs metadata for a file without pages or I/O.
+   */
+  FileMetadata()
+      : header(),
+        header_dirty(false),
+        pending_allocations(0),
+        page_reads(0),
+        page_writes(0),
+        metadata_reads(0),
+        metadata_writes(0) {
   }
 };
 
@@ -60,37 +165,105 @@ struct FileHeader {
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
  *
- * The File class wraps a stream to an underlying file on disk.  Files contain
+ * The File class wraps a FileIO object accessing an underlying file on disk
+ * through one of the FileBackend backends.  Files contain
  * fixed-sized pages, and they never deallocate space (though they do reuse
- * deleted pages if possible).  If multiple File objects refer to the same
- * underlying file, they will share the stream in memory.
+ * deleted pages if possible).
+ *
+ * Pages are split into groups of PAGES_PER_MAP pages, the first of which is a
+ * map page holding, from MAP_OFFSET on, a bitmap with one bit per page of the
+ * group telling whether the page is in use.  The map page of the first group
+ * is page 0, which also holds the FileHeader in front of its bitmap.  Allocating and
+ * deleting a page therefore changes one map byte and the header, no matter how
+ * large the file is.
+ *
+ * The header and the maps are cached in memory while the file is open, so
+ * reading or writing a page costs one I/O and allocating or deleting a page
+ * at most one.  They are written back by flushMetadata(), which is called
+ * when the last File object of the file is closed and by
+ * BufMgr::flushFile().  Until then a crash may lose allocations and
+ * deletions.  If multiple File objects refer to the same
+ * underlying file, they will share the FileIO object in memory.
  * If a file that has already been opened (possibly by another query), then the File class
- * detects this (by looking in the open_streams_ map) and just returns a file object with
- * the already created stream for the file without actually opening the UNIX file again. 
+ * detects this (by looking in the open_files_ map) and just returns a file object with
+ * the already created FileIO for the file without actually opening the UNIX file again. 
+ *
+ * Reading, writing, allocating and deleting pages is threadsafe.  The cached
+ * metadata is only latched to check or update it, not across page I/O, so
+ * with backends other than STREAM page reads, writes and allocations also
+ * run in parallel.  Writing a page while another thread deletes it is an
+ * error the file does not detect.
  *
- * @warning This class is not threadsafe.
+ * @warning Creating, opening, copying and closing File objects is not
+ *          threadsafe.
  */
 class File {
  public:
+  /**
+   * Value of FileHeader::magic in every BadgerDB file.
+   */
+  static const std::uint32_t MAGIC = 0x42444742;
+
+  /**
+   * Current on-disk format version.  Version 3 added the used-slot bitmap to
+   * the page header, and version 4 packed slots into 4 bytes.  open() converts
+   * files of older versions first, unless they are opened read-only.
+   */
+  static const std::uint32_t FORMAT_VERSION = 4;
+
+  /**
+   * Oldest format version convert() understands.  Version 1 is the layout of
+   * files written before format versions existed: no magic number, used and
+   * free pages chained in lists through the page headers, and 6-byte slots.
+   * Version 2 replaced the lists with map pages.
+   */
+  static const std::uint32_t OLDEST_CONVERTIBLE_VERSION = 1;
+
+  /**
+   * Offset of the bitmap within a map page; the bytes before it hold the
+   * FileHeader in page 0 and are unused in the other map pages.
+   */
+  static const std::uint32_t MAP_OFFSET = 64;
+
+  /**
+   * Number of pages described by one map page, including the map page itself.
+   */
+  static const PageId PAGES_PER_MAP = (Page::SIZE - MAP_OFFSET) * 8;
+
   /**
    * Creates a new file.
    *
    * @param filename  Name of the file.
+   * @param backend   How to access the file on disk.
+   * @param growth_room Number of bytes a FileBackend::MMAP file can grow by
+   *                    before it is closed; see MmapFileIO.
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static File create(const std::string& filename);
+  static File create(const std::string& filename,
+                     const FileBackend backend = FileBackend::STREAM,
+                     const std::uint64_t growth_room = FileIO::DEFAULT_GROWTH_ROOM);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
-	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
-	 * that already open file. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
-	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
-	 * open_streams_ map.
+	 * It first checks if the file is already open. If so, then the new File object created uses the same FileIO object to read to or write fom
+	 * that already open file, whatever backend it was opened with. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
+	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the FileIO associated with this File object are inserted into the
+	 * open_files_ map.
    *
    * @param filename  Name of the file.
+   * @param backend   How to access the file on disk if it is not open yet.
+   * @param growth_room Number of bytes a FileBackend::MMAP file can grow by
+   *                    before it is closed, if it is not open yet.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  InvalidFileFormatException  If the file has an unknown format
+   *                                      version, is not a BadgerDB file, or
+   *                                      has an older format version and is
+   *                                      opened with
+   *                                      FileBackend::MMAP_READ_ONLY.
    */
-  static File open(const std::string& filename);
+  static File open(const std::string& filename,
+                   const FileBackend backend = FileBackend::STREAM,
+                   const std::uint64_t growth_room = FileIO::DEFAULT_GROWTH_ROOM);
 
   /**
    * Deletes an existing file.
@@ -116,6 +289,28 @@ class File {
    */
   static bool exists(const std::string& filename);
 
+  /**
+   * Converts a file written with an older format version to the current one,
+   * keeping the numbers of all pages and the IDs of all records.  The
+   * converted file is written next to the old one and then renamed over it,
+   * so a failed conversion leaves the old file as it was.  Does nothing if
+   * the file already has the current format.  A file without the magic
+   * number is taken to be of version 1; its page lists are checked and
+   * turned into map pages.  As page numbers are kept, a version 1 file can
+   * have at most PAGES_PER_MAP pages, so that none of them falls where a
+   * map page goes now.  open() calls this for files that aren't open yet.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileNotFoundException   If the file doesn't exist.
+   * @throws  FileOpenException       If the file is currently open.
+   * @throws  InvalidFileFormatException  If the file is not a BadgerDB file,
+   *                                      has a version newer than
+   *                                      FORMAT_VERSION, or has a page
+   *                                      that is corrupt or doesn't fit a
+   *                                      page of the current format.
+   */
+  static void convert(const std::string& filename);
+
   /**
    * Copy constructor.
    * 
@@ -145,6 +340,20 @@ class File {
    */
   Page allocatePage();
 
+  /**
+   * Allocates a new page in the file, building it directly in a page owned
+   * by the caller, such as a buffer pool frame.  The page number is taken
+   * under the metadata latch and the page written after releasing it;
+   * flushMetadata() waits for such writes, so maps never reach the disk
+   * ahead of the pages they count.  If the write fails the page is left in
+   * the file as a free page.
+   *
+   * @param new_page  Overwritten with the new page.
+   * @throws  FileIOException   If the file is read-only or the page can't be
+   *                            written.
+   */
+  void allocatePage(Page& new_page);
+
   /**
    * Reads an existing page from the file.
    *
@@ -155,6 +364,33 @@ class File {
    */
   Page readPage(const PageId page_number) const;
 
+  /**
+   * Reads an existing page from the file straight into a page owned by the
+   * caller, such as a buffer pool frame, with a single read of Page::SIZE
+   * bytes.  The page is overwritten even if the read fails.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Overwritten with the page read.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  void readPage(const PageId page_number, Page& page) const;
+
+  /**
+   * Returns an existing page in place in the memory mapping of the file,
+   * without reading or copying it.  The page stays valid while the file is
+   * open; it changes when the page is written and must not be used after the
+   * page has been deleted.
+   *
+   * @param page_number   Number of page to view.
+   * @return  The page.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  FileIOException   If the file was not opened with one of the MMAP
+   *                            backends.
+   */
+  const Page& viewPage(const PageId page_number) const;
+
   /**
    * Writes a page into the file, replacing any existing contents.  The page
    * must have been already allocated in this file by a call to allocatePage().
@@ -164,6 +400,46 @@ class File {
    */
   void writePage(const Page& new_page);
 
+  /**
+   * Reads several existing pages at once.  The reads are submitted as one
+   * batch, which the backend may keep in flight together; see
+   * FileIO::submit().
+   *
+   * @param page_numbers  Numbers of the pages to read.
+   * @param pages         pages[i] is overwritten with page page_numbers[i].
+   * @param count         Number of pages.
+   * @param valid         If not NULL, valid[i] is set to whether page i exists
+   *                      and is used, and invalid pages don't throw.  The
+   *                      contents of invalid pages are undefined.
+   * @throws  InvalidPageException  If valid is NULL and a page doesn't exist
+   *                                in the file or is not currently used.
+   */
+  void readPages(const PageId* page_numbers, Page* const* pages,
+                 const std::size_t count, bool* valid = NULL) const;
+
+  /**
+   * Writes several pages at once, each replacing the existing contents of
+   * its page.  The pages are written in page number order; runs of
+   * consecutive pages go to disk as one vectored write, see
+   * FileIO::writeVectored(), and the remaining pages are submitted as one
+   * batch, see FileIO::submit().
+   *
+   * @see writePage()
+   * @param pages   Pages to write.
+   * @param count   Number of pages.
+   * @throws  InvalidPageException  If any page is not in use; nothing is
+   *                                written then.
+   */
+  void writePages(const Page* const* pages, const std::size_t count);
+
+  /**
+   * Returns true if batches of reads and writes are kept in flight together
+   * rather than done one by one.
+   *
+   * @return  Whether the backend has an asynchronous engine.
+   */
+  bool asynchronousBatches() const { return io_->asynchronous(); }
+
   /**
    * Deletes a page from the file.
    *
@@ -171,6 +447,50 @@ class File {
    */
   void deletePage(const PageId page_number);
 
+  /**
+   * Writes the cached header and changed map pages back to disk.  Pages are
+   * always written before the maps describing them, and the maps before the
+   * header, so the file on disk never counts pages it does not have.
+   */
+  void flushMetadata() const;
+
+  /**
+   * Waits until every page written so far, and then the metadata describing
+   * them, is on disk.
+   *
+   * @throws  FileIOException   If the file can't be written back.
+   */
+  void sync();
+
+  /**
+   * Tells the operating system how the file is going to be read, so it can
+   * adjust read-ahead for the file or its mapping.
+   *
+   * @param pattern   Expected access pattern.
+   */
+  void adviseAccess(const AccessPattern pattern);
+
+  /**
+   * Returns the I/O done on the file since it was opened or the counts were
+   * last cleared.
+   *
+   * @return  Copy of the counters.
+   */
+  FileStats stats() const;
+
+  /**
+   * Resets the counters returned by stats() to 0.
+   */
+  void clearStats();
+
+  /**
+   * Returns the number of pages the file spans, counting map pages and free
+   * pages.  Every page number in use is below it.
+   *
+   * @return  Number of pages in the file.
+   */
+  PageId numPages() const;
+
   /**
    * Returns the name of the file this object represents.
    *
@@ -178,6 +498,13 @@ class File {
    */
   const std::string& filename() const { return filename_; }
 
+  /**
+   * Returns the backend used to access the file on disk.
+   *
+   * @return Backend of file.
+   */
+  FileBackend backend() const { return io_->backend(); }
+
   /**
    * Returns an iterator at the first page in the file.
    *
@@ -194,6 +521,19 @@ class File {
   FileIterator end();
 
  private:
+  /**
+   * Writes the converted copy of a version 1 file, see convert().
+   *
+   * @param filename  Name of the file, for errors.
+   * @param in        The version 1 file.
+   * @param out       Empty file to write the converted copy to.
+   * @throws  InvalidFileFormatException  If the page lists are broken, the
+   *                                      file has too many pages or a page
+   *                                      can't be converted.
+   */
+  static void convertBaseline(const std::string& filename, FileIO& in,
+                              FileIO& out);
+
   /**
    * Returns the position of the page with the given number in the file (as an
    * offset from the beginning of the file).
@@ -201,10 +541,81 @@ class File {
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+  static std::uint64_t pagePosition(const PageId page_number) {
+    return static_cast<std::uint64_t>(page_number) * Page::SIZE;
+  }
+
+  /**
+   * Returns the map group the given page belongs to.
+   *
+   * @param page_number   Number of page.
+   * @return  Index of the group.
+   */
+  static PageId mapGroup(const PageId page_number) {
+    return page_number / PAGES_PER_MAP;
+  }
+
+  /**
+   * Returns true if the given page number is the map page of its group.
+   *
+   * @param page_number   Number of page.
+   * @return  Whether the page is a map page.
+   */
+  static bool isMapPage(const PageId page_number) {
+    return page_number % PAGES_PER_MAP == 0;
   }
 
+  /**
+   * Returns the position in the file of the map byte holding the bit of the
+   * given page.
+   *
+   * @param page_number   Number of page.
+   * @return  Position of the byte in the file.
+   */
+  static std::uint64_t mapBytePosition(const PageId page_number) {
+    const PageId bit = page_number % PAGES_PER_MAP;
+    return pagePosition(page_number - bit) + MAP_OFFSET + bit / 8;
+  }
+
+  /**
+   * Finds the lowest numbered free page, starting at the group in
+   * free_search_group of the cached header and moving it forward past full
+   * groups.  The metadata latch must be held and the file must have a free
+   * page.
+   *
+   * @return  Number of the free page.
+   */
+  PageId findFreePage();
+
+  /**
+   * Returns whether the cached map marks the given page as used.  The
+   * metadata latch must be held.
+   *
+   * @param page_number   Number of a page that is not a map page.
+   * @return  True if the page is in use.
+   */
+  bool isPageUsed(const PageId page_number) const;
+
+  /**
+   * Marks the given page as used or free in the cached map.  The metadata
+   * latch must be held.
+   *
+   * @param page_number   Number of a page that is not a map page.
+   * @param used          Whether the page is now in use.
+   */
+  void setPageUsed(const PageId page_number, const bool used);
+
+  /**
+   * Returns the first used page after the given one, found in the cached
+   * maps.
+   *
+   * @param page_number   Page to start after, or Page::INVALID_NUMBER to
+   *                      start at the beginning of the file.
+   * @return  Number of the next used page, or Page::INVALID_NUMBER if there is
+   *          none.
+   */
+  PageId nextUsedPage(const PageId page_number) const;
+
   /**
    * Constructs a file object representing a file on the filesystem.
    * This method should not be called directly; instead use the static methods
@@ -214,28 +625,35 @@ class File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param backend     How to access the file on disk.
+   * @param growth_room Room for a FileBackend::MMAP file to grow.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  File(const std::string& name, const bool create_new);
+  File(const std::string& name, const bool create_new,
+       const FileBackend backend, const std::uint64_t growth_room);
 
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * the same filesystem file; otherwise, it reuses the existing FileIO.
    *
    * @param create_new  Whether to create a new file.
+   * @param backend     How to access the file on disk if it is not open yet.
+   * @param growth_room Room for a FileBackend::MMAP file to grow, if it is
+   *                    not open yet.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  void openIfNeeded(const bool create_new);
+  void openIfNeeded(const bool create_new, const FileBackend backend,
+                    const std::uint64_t growth_room);
 
   /**
-   * Closes the underlying file stream in <stream_>.
+   * Closes the underlying FileIO in <io_>.
    * This method only closes the file if no other File objects exist that access
    * the same file.
    */
@@ -245,17 +663,30 @@ class File {
    * Reads a page from the file.  If <allow_free> is not set, an exception
    * will be thrown if the page read from disk is not currently in use.
    *
-   * No bounds checking is performed; the underlying file stream will throw
-   * an exception if the page is past the end of the file.
+   * Pages past the end of the file are rejected with an InvalidPageException.
    *
    * @param page_number   Number of page to read.
    * @param allow_free    Whether to allow reading a free (unused) page.
    * @return  The page.
-   * @throws  InvalidPageException  If the page is free (unused) and
-   *                                allow_free is false.
+   * @throws  InvalidPageException  If the page doesn't exist in the file, or
+   *                                is free (unused) and allow_free is false.
    */
   Page readPage(const PageId page_number, const bool allow_free) const;
 
+  /**
+   * Reads a page from the file into the given page.  Pages past the end of
+   * the file are detected by the read coming up short, so the file header is
+   * not consulted.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Overwritten with the page read.
+   * @param allow_free    Whether to allow reading a free (unused) page.
+   * @throws  InvalidPageException  If the page doesn't exist in the file, or
+   *                                is free (unused) and allow_free is false.
+   */
+  void readPage(const PageId page_number, Page& page,
+                const bool allow_free) const;
+
   /**
    * Writes a page into the file at the given page number.  This does not
    * update ensure that the number in the header equals the position on disk.
@@ -267,16 +698,13 @@ class File {
   void writePage(const PageId page_number, const Page& new_page);
 
   /**
-   * Writes a page into the file at the given page number with the given header.
-   * This does not ensure that the number in the header equals the position on
-   * disk.  No bounds checking is performed.
+   * Ends an allocation started by allocatePage(), giving the page back as a
+   * free page if its first write failed.
    *
-   * @param page_number Number of page whose contents to replace.
-   * @param header      Header of page to write.
-   * @param new_page    Page to write.
+   * @param page_number   Number of the page allocated.
+   * @param written       Whether the page was written.
    */
-  void writePage(const PageId page_number, const PageHeader& header,
-                 const Page& new_page);
+  void finishAllocation(const PageId page_number, const bool written);
 
   /**
    * Reads the header for this file from disk.
@@ -290,40 +718,55 @@ class File {
    *
    * @param header  File header to write.
    */
-  void writeHeader(const FileHeader& header);
+  void writeHeader(const FileHeader& header) const;
 
   /**
-   * Reads only the header of the given page from disk (not the record data
-   * or slot table).  No bounds checking is performed.
+   * Fills in the cached metadata of a file that was just opened: a fresh
+   * header for a new file, or the header and maps read from disk.
    *
-   * @param page_number   Number of page whose header is to be read.
-   * @return  Header of page.
+   * @param create_new  Whether the file was just created.
+   * @throws  InvalidFileFormatException  If an existing file has an unknown
+   *                                      format version or is not a BadgerDB
+   *                                      file.
    */
-  PageHeader readPageHeader(const PageId page_number) const;
+  void loadMetadata(const bool create_new);
 
   typedef std::map<std::string,
-                   std::shared_ptr<std::fstream> > StreamMap;
+                   std::shared_ptr<FileIO> > FileIOMap;
   typedef std::map<std::string, int> CountMap;
 
   /**
-   * Streams for opened files.
+   * FileIO objects for opened files.
    */
-  static StreamMap open_streams_;
+  static FileIOMap open_files_;
 
   /**
    * Counts for opened files.
    */
   static CountMap open_counts_;
 
+  typedef std::map<std::string,
+                   std::shared_ptr<FileMetadata> > MetadataMap;
+
+  /**
+   * Cached metadata of opened files.
+   */
+  static MetadataMap open_metadata_;
+
   /**
    * Name of the file this object represents.
    */
   std::string filename_;
 
   /**
-   * Stream for underlying filesystem object.
+   * Reads and writes the underlying filesystem object.
+   */
+  std::shared_ptr<FileIO> io_;
+
+  /**
+   * Cached header and maps of the file.
    */
-  std::shared_ptr<std::fstream> stream_;
+  std::shared_ptr<FileMetadata> metadata_;
 
   friend class FileIterator;
   friend class FileTest;
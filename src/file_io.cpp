@@ -0,0 +1,56 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "file_io.h"
+
+#include "descriptor_file_io.h"
+#include "mmap_file_io.h"
+#include "stream_file_io.h"
+
+namespace badgerdb {
+
+const std::uint64_t FileIO::DEFAULT_GROWTH_ROOM;
+
+FileIO* FileIO::open(const std::string& filename, const FileBackend backend,
+                     const bool truncate, const std::uint64_t growth_room) {
+  switch (backend) {
+    case FileBackend::DESCRIPTOR:
+      return new DescriptorFileIO(filename, truncate, false /* direct */);
+    case FileBackend::DIRECT:
+      return new DescriptorFileIO(filename, truncate, true /* direct */);
+    case FileBackend::MMAP:
+      return new MmapFileIO(filename, truncate, false /* read_only */,
+                            growth_room);
+    case FileBackend::MMAP_READ_ONLY:
+      return new MmapFileIO(filename, truncate, true /* read_only */);
+    case FileBackend::STREAM:
+    default:
+      return new StreamFileIO(filename, truncate);
+  }
+}
+
+void FileIO::writeVectored(const char* const* buffers,
+                           const std::size_t count, const std::size_t length,
+                           const std::uint64_t offset) {
+  for (std::size_t i = 0; i < count; ++i) {
+    writeAt(buffers[i], length, offset + i * length);
+  }
+}
+
+void FileIO::submit(IoRequest* requests, const std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    IoRequest& request = requests[i];
+    if (request.write) {
+      writeAt(request.buffer, request.length, request.offset);
+      request.done = request.length;
+    } else {
+      request.done = readAt(request.buffer, request.length, request.offset);
+    }
+  }
+}
+
+}
@@ -0,0 +1,261 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace badgerdb {
+
+/**
+ * @brief Ways a File can access the underlying file on disk.
+ */
+enum class FileBackend {
+  /**
+   * A std::fstream.  Every read and write is a seek followed by a transfer,
+   * so accesses to the file are serialized.
+   */
+  STREAM,
+
+  /**
+   * A file descriptor accessed with pread() and pwrite(), so any number of
+   * threads can read and write the file at the same time.
+   */
+  DESCRIPTOR,
+
+  /**
+   * Like DESCRIPTOR, but opened with O_DIRECT so transfers bypass the
+   * operating system's page cache.  Transfers whose buffer, length and
+   * offset are multiples of FileIO::DIRECT_ALIGNMENT, such as whole pages
+   * read into buffer pool frames, go straight between the buffer and the
+   * disk; others go through an aligned bounce buffer.
+   */
+  DIRECT,
+
+  /**
+   * A shared memory mapping of the file.  Reads and writes copy from and to
+   * the mapping, pages can be viewed in place with File::viewPage(), and
+   * File::sync() uses msync().
+   */
+  MMAP,
+
+  /**
+   * A read-only memory mapping of the file.  Pages can be viewed in place;
+   * any write throws a FileIOException.
+   */
+  MMAP_READ_ONLY
+};
+
+/**
+ * @brief How a file is going to be accessed, passed on to the operating
+ *        system so it can tune read-ahead.
+ */
+enum class AccessPattern {
+  /**
+   * No particular pattern; the default.
+   */
+  NORMAL,
+
+  /**
+   * Pages are read in order, so reading far ahead pays off.
+   */
+  SEQUENTIAL,
+
+  /**
+   * Pages are read in no particular order, so read-ahead is wasted.
+   */
+  RANDOM
+};
+
+/**
+ * @brief One read or write of a batch passed to FileIO::submit().
+ */
+struct IoRequest {
+  /**
+   * Whether buffer is written to the file, rather than read into.
+   */
+  bool write;
+
+  /**
+   * Bytes to write, or buffer receiving the bytes read.
+   */
+  char* buffer;
+
+  /**
+   * Number of bytes to transfer.
+   */
+  std::size_t length;
+
+  /**
+   * Position in the file to transfer at.
+   */
+  std::uint64_t offset;
+
+  /**
+   * Set by submit() to the number of bytes transferred.  Fewer than length
+   * bytes are read only at the end of the file.
+   */
+  std::size_t done;
+};
+
+/**
+ * @brief Positional I/O on an open file.
+ *
+ * One FileIO is shared by all File objects referring to the same file.  All
+ * methods are threadsafe.
+ */
+class FileIO {
+ public:
+  /**
+   * Alignment of buffers, lengths and offsets the DIRECT backend transfers
+   * without a bounce buffer.  A multiple of the sector size of common disks.
+   */
+  static const std::size_t DIRECT_ALIGNMENT = 4096;
+
+  /**
+   * Default number of bytes a file opened with FileBackend::MMAP can grow by
+   * while it is open, see open().
+   */
+  static const std::uint64_t DEFAULT_GROWTH_ROOM = 1ULL << 30;
+
+  /**
+   * Returns true if a transfer can be done with the DIRECT backend without a
+   * bounce buffer.
+   *
+   * @param buffer  Buffer of the transfer.
+   * @param length  Number of bytes to transfer.
+   * @param offset  Position in the file.
+   * @return  Whether buffer, length and offset are suitably aligned.
+   */
+  static bool directAligned(const char* buffer, const std::size_t length,
+                            const std::uint64_t offset) {
+    return reinterpret_cast<std::uintptr_t>(buffer) % DIRECT_ALIGNMENT == 0 &&
+        length % DIRECT_ALIGNMENT == 0 && offset % DIRECT_ALIGNMENT == 0;
+  }
+
+  /**
+   * Opens a file with the given backend.  The file must exist unless
+   * truncate is set, in which case it is created if needed.
+   *
+   * @param filename  Name of the file.
+   * @param backend   Backend to access the file with.
+   * @param truncate  Whether to discard the existing contents of the file.
+   * @param growth_room Number of bytes a FileBackend::MMAP file can grow by
+   *                    while open; ignored by the other backends.
+   * @return  Newly allocated FileIO, owned by the caller.
+   * @throws  FileIOException   If the file can't be opened.
+   */
+  static FileIO* open(const std::string& filename, const FileBackend backend,
+                      const bool truncate,
+                      const std::uint64_t growth_room = DEFAULT_GROWTH_ROOM);
+
+  virtual ~FileIO() {}
+
+  /**
+   * Returns the backend of this object.
+   */
+  virtual FileBackend backend() const = 0;
+
+  /**
+   * Reads up to length bytes at the given offset of the file.  Fewer bytes
+   * are read only at the end of the file.
+   *
+   * @param buffer  Buffer receiving the bytes.
+   * @param length  Number of bytes to read.
+   * @param offset  Position in the file to read from.
+   * @return  Number of bytes read.
+   * @throws  FileIOException   If the read fails.
+   */
+  virtual std::size_t readAt(char* buffer, const std::size_t length,
+                             const std::uint64_t offset) = 0;
+
+  /**
+   * Writes length bytes at the given offset of the file, extending the file
+   * if needed.
+   *
+   * @param buffer  Bytes to write.
+   * @param length  Number of bytes to write.
+   * @param offset  Position in the file to write to.
+   * @throws  FileIOException   If the write fails.
+   */
+  virtual void writeAt(const char* buffer, const std::size_t length,
+                       const std::uint64_t offset) = 0;
+
+  /**
+   * Writes count buffers of length bytes each back to back, starting at the
+   * given offset of the file, as one transfer where the backend supports
+   * it.  The default writes one buffer after the other with writeAt().
+   *
+   * @param buffers   Bytes to write.
+   * @param count     Number of buffers.
+   * @param length    Number of bytes in each buffer.
+   * @param offset    Position in the file of the first buffer.
+   * @throws  FileIOException   If the write fails.
+   */
+  virtual void writeVectored(const char* const* buffers,
+                             const std::size_t count,
+                             const std::size_t length,
+                             const std::uint64_t offset);
+
+  /**
+   * Waits until everything written so far is on disk.
+   *
+   * @throws  FileIOException   If the data can't be written back.
+   */
+  virtual void sync() = 0;
+
+  /**
+   * Carries out a batch of reads and writes, in any order, and returns once
+   * all of them are complete.  Backends with an asynchronous engine keep up
+   * to the whole batch in flight at once; the default does one request after
+   * the other with readAt() and writeAt().
+   *
+   * @param requests  Transfers to do; their done members are set.
+   * @param count     Number of requests.
+   * @throws  FileIOException   If any transfer fails.  The other transfers
+   *                            may or may not have been done.
+   */
+  virtual void submit(IoRequest* requests, const std::size_t count);
+
+  /**
+   * Returns true if submit() overlaps the requests of a batch rather than
+   * doing them one by one.
+   */
+  virtual bool asynchronous() const { return false; }
+
+  /**
+   * Tells the operating system how the file will be accessed.  Only a hint;
+   * backends that can't use it ignore it.
+   *
+   * @param pattern   Expected access pattern.
+   */
+  virtual void advise(const AccessPattern pattern) {}
+
+  /**
+   * Returns the start of a memory mapping of the file, which stays at the
+   * same address while the file is open, or NULL if the backend doesn't map
+   * the file.
+   */
+  virtual const char* mapping() const { return NULL; }
+
+ protected:
+  /**
+   * Constructs the part common to all backends.
+   *
+   * @param filename  Name of the file, used in error messages.
+   */
+  explicit FileIO(const std::string& filename) : filename_(filename) {}
+
+  /**
+   * Name of the file.
+   */
+  const std::string filename_;
+};
+
+}
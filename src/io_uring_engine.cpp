@@ -0,0 +1,228 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "io_uring_engine.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define BADGERDB_HAVE_IO_URING
+#endif
+#endif
+
+namespace badgerdb {
+
+const unsigned IoUringEngine::QUEUE_DEPTH;
+
+#ifdef BADGERDB_HAVE_IO_URING
+
+namespace {
+
+/**
+ * Returns the field at the given offset of a ring mapping.
+ */
+unsigned* ringField(void* ring, const unsigned offset) {
+  return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset);
+}
+
+}
+
+IoUringEngine* IoUringEngine::create() {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  const int ring_fd = syscall(__NR_io_uring_setup, QUEUE_DEPTH, &params);
+  if (ring_fd < 0) {
+    // Not supported by the kernel, or not allowed.
+    return NULL;
+  }
+
+  std::size_t sq_ring_size =
+      params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  std::size_t cq_ring_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+  }
+  void* sq_ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+  void* cq_ring = sq_ring;
+  if (sq_ring != MAP_FAILED && !single_mmap) {
+    cq_ring = mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+  }
+  const std::size_t sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = MAP_FAILED;
+  if (cq_ring != MAP_FAILED) {
+    sqes = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+  }
+  if (sqes == MAP_FAILED) {
+    if (cq_ring != MAP_FAILED && cq_ring != sq_ring) {
+      munmap(cq_ring, cq_ring_size);
+    }
+    if (sq_ring != MAP_FAILED) {
+      munmap(sq_ring, sq_ring_size);
+    }
+    close(ring_fd);
+    return NULL;
+  }
+
+  IoUringEngine* engine = new IoUringEngine();
+  engine->ring_fd_ = ring_fd;
+  engine->sq_ring_ = sq_ring;
+  engine->sq_ring_size_ = sq_ring_size;
+  engine->cq_ring_ = cq_ring;
+  engine->cq_ring_size_ = cq_ring_size;
+  engine->sqes_ = sqes;
+  engine->sqes_size_ = sqes_size;
+  engine->sq_tail_ = ringField(sq_ring, params.sq_off.tail);
+  engine->sq_mask_ = ringField(sq_ring, params.sq_off.ring_mask);
+  engine->sq_array_ = ringField(sq_ring, params.sq_off.array);
+  engine->sq_entries_ = params.sq_entries;
+  engine->cq_head_ = ringField(cq_ring, params.cq_off.head);
+  engine->cq_tail_ = ringField(cq_ring, params.cq_off.tail);
+  engine->cq_mask_ = ringField(cq_ring, params.cq_off.ring_mask);
+  engine->cqes_ = ringField(cq_ring, params.cq_off.cqes);
+  return engine;
+}
+
+IoUringEngine::~IoUringEngine() {
+  munmap(sqes_, sqes_size_);
+  if (cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  munmap(sq_ring_, sq_ring_size_);
+  close(ring_fd_);
+}
+
+int IoUringEngine::submit(const int fd, IoRequest* requests,
+                          const std::size_t count) {
+  std::lock_guard<std::mutex> guard(latch_);
+  io_uring_sqe* sqes = static_cast<io_uring_sqe*>(sqes_);
+  io_uring_cqe* cqes = static_cast<io_uring_cqe*>(cqes_);
+  std::vector<iovec> iovecs(count);
+  // Requests still to be queued, either new or resubmitted after a short
+  // transfer.
+  std::vector<std::size_t> pending;
+  pending.reserve(count);
+  for (std::size_t i = count; i > 0; --i) {
+    requests[i - 1].done = 0;
+    pending.push_back(i - 1);
+  }
+  int error = 0;
+  unsigned queued = 0;
+  unsigned in_flight = 0;
+
+  while (!pending.empty() || queued > 0 || in_flight > 0) {
+    // Fill the submission queue.
+    unsigned tail = *sq_tail_;
+    while (!pending.empty() && queued + in_flight < sq_entries_) {
+      const std::size_t i = pending.back();
+      pending.pop_back();
+      IoRequest& request = requests[i];
+      iovecs[i].iov_base = request.buffer + request.done;
+      iovecs[i].iov_len = request.length - request.done;
+      const unsigned index = tail & *sq_mask_;
+      io_uring_sqe& sqe = sqes[index];
+      std::memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = request.write ? IORING_OP_WRITEV : IORING_OP_READV;
+      sqe.fd = fd;
+      sqe.addr = reinterpret_cast<std::uint64_t>(&iovecs[i]);
+      sqe.len = 1;
+      sqe.off = request.offset + request.done;
+      sqe.user_data = i;
+      sq_array_[index] = index;
+      ++tail;
+      ++queued;
+    }
+    // The kernel must see the entries before the new tail.
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+    const int submitted = syscall(__NR_io_uring_enter, ring_fd_, queued,
+                                  1 /* min_complete */,
+                                  IORING_ENTER_GETEVENTS, NULL, 0);
+    if (submitted < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+        continue;
+      }
+      // Nothing more can be submitted.  The kernel has not looked at the
+      // queued entries yet, so take them back and wait for the requests in
+      // flight.
+      if (error == 0) {
+        error = errno;
+      }
+      __atomic_store_n(sq_tail_, tail - queued, __ATOMIC_RELEASE);
+      queued = 0;
+      if (in_flight == 0) {
+        break;
+      }
+    } else {
+      queued -= submitted;
+      in_flight += submitted;
+    }
+
+    // Reap completions.
+    unsigned head = *cq_head_;
+    const unsigned cq_tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != cq_tail; ++head) {
+      const io_uring_cqe& cqe = cqes[head & *cq_mask_];
+      IoRequest& request = requests[cqe.user_data];
+      --in_flight;
+      if (cqe.res < 0) {
+        if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+          pending.push_back(cqe.user_data);
+        } else if (error == 0) {
+          error = -cqe.res;
+        }
+      } else if (cqe.res > 0) {
+        request.done += cqe.res;
+        if (request.done < request.length) {
+          pending.push_back(cqe.user_data);
+        }
+      } else if (request.write) {
+        // A write that makes no progress would loop forever.
+        if (error == 0) {
+          error = EIO;
+        }
+      }
+      // A read of 0 bytes is the end of the file.
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    if (error != 0) {
+      pending.clear();
+    }
+  }
+  return error;
+}
+
+#else
+
+IoUringEngine* IoUringEngine::create() {
+  return NULL;
+}
+
+IoUringEngine::~IoUringEngine() {
+}
+
+int IoUringEngine::submit(const int fd, IoRequest* requests,
+                          const std::size_t count) {
+  return ENOSYS;
+}
+
+#endif
+
+}
@@ -0,0 +1,107 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+
+#include "file_io.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Runs batches of reads and writes through a Linux io_uring.
+ *
+ * The ring is set up with the raw system calls, so no library is needed.  A
+ * batch is queued as a whole, up to the size of the submission queue at a
+ * time, and completions are reaped until every request is done; short
+ * transfers are resubmitted for the remaining bytes.
+ *
+ * One batch runs at a time; concurrent callers wait for each other.
+ */
+class IoUringEngine {
+ public:
+  /**
+   * Number of entries requested for the submission queue, and so the most
+   * requests in flight at once.
+   */
+  static const unsigned QUEUE_DEPTH = 64;
+
+  /**
+   * Sets up a ring.
+   *
+   * @return  Newly allocated engine, owned by the caller, or NULL if the
+   *          kernel or the build doesn't support io_uring.
+   */
+  static IoUringEngine* create();
+
+  /**
+   * Tears down the ring.
+   */
+  ~IoUringEngine();
+
+  /**
+   * Carries out a batch of reads and writes on a file descriptor and waits
+   * for all of them.
+   *
+   * @param fd        Descriptor of the file.
+   * @param requests  Transfers to do; their done members are set.
+   * @param count     Number of requests.
+   * @return  0, or the errno value of the first transfer that failed.
+   */
+  int submit(const int fd, IoRequest* requests, const std::size_t count);
+
+ private:
+  /**
+   * Constructs an engine on a ring that has been set up.  See create().
+   */
+  IoUringEngine() {}
+
+  /**
+   * Descriptor of the ring.
+   */
+  int ring_fd_;
+
+  /**
+   * Mappings of the submission and completion queue rings, which may be the
+   * same mapping, and their lengths.
+   */
+  void* sq_ring_;
+  std::size_t sq_ring_size_;
+  void* cq_ring_;
+  std::size_t cq_ring_size_;
+
+  /**
+   * Mapping of the submission queue entries and its length.
+   */
+  void* sqes_;
+  std::size_t sqes_size_;
+
+  /**
+   * Fields of the submission queue ring.
+   */
+  unsigned* sq_tail_;
+  unsigned* sq_mask_;
+  unsigned* sq_array_;
+  unsigned sq_entries_;
+
+  /**
+   * Fields of the completion queue ring.
+   */
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned* cq_mask_;
+  void* cqes_;
+
+  /**
+   * Serializes batches.
+   */
+  std::mutex latch_;
+};
+
+}
@@ -0,0 +1,128 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "lru_k_policy.h"
+
+namespace badgerdb {
+
+LruKPolicy::LruKPolicy(const std::uint32_t numBufs, const std::uint32_t k)
+    : numBufs(numBufs),
+      k(k),
+      now(0),
+      resident(numBufs, false),
+      keys(numBufs),
+      histories(numBufs) {
+}
+
+LruKPolicy::OrderKey LruKPolicy::orderKey(const FrameId frame) const {
+  const History& history = histories[frame];
+  const std::uint64_t kth = history.size() < k ? 0 : history[k - 1];
+  return OrderKey(kth, history.front());
+}
+
+void LruKPolicy::reference(History& history) {
+  history.insert(history.begin(), ++now);
+  if (history.size() > k) {
+    history.pop_back();
+  }
+}
+
+void LruKPolicy::retain(const FrameId frame) {
+  const PageKey& key = keys[frame];
+  retainedOrder.push_front(key);
+  RetainedHistory& entry = retained[key];
+  entry.history.swap(histories[frame]);
+  entry.pos = retainedOrder.begin();
+  if (retained.size() > numBufs) {
+    retained.erase(retainedOrder.back());
+    retainedOrder.pop_back();
+  }
+}
+
+void LruKPolicy::resize(const std::uint32_t numBufs) {
+  std::lock_guard<std::mutex> guard(latch);
+  this->numBufs = numBufs;
+  // per frame state is only ever grown; frames past the end are untracked
+  if (numBufs > resident.size()) {
+    resident.resize(numBufs, false);
+    keys.resize(numBufs);
+    histories.resize(numBufs);
+  }
+  while (retained.size() > numBufs) {
+    retained.erase(retainedOrder.back());
+    retainedOrder.pop_back();
+  }
+}
+
+void LruKPolicy::frameLoaded(const FrameId frame, const File* file,
+                             const PageId pageNo) {
+  std::lock_guard<std::mutex> guard(latch);
+  const PageKey key = {file, pageNo};
+  History& history = histories[frame];
+  history.clear();
+  std::unordered_map<PageKey, RetainedHistory, PageKeyHash>::iterator old =
+      retained.find(key);
+  if (old != retained.end()) {
+    history.swap(old->second.history);
+    retainedOrder.erase(old->second.pos);
+    retained.erase(old);
+  }
+  reference(history);
+  keys[frame] = key;
+  resident[frame] = true;
+  order[orderKey(frame)] = frame;
+}
+
+void LruKPolicy::frameAccessed(const FrameId frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  if (!resident[frame]) {
+    return;
+  }
+  order.erase(orderKey(frame));
+  reference(histories[frame]);
+  order[orderKey(frame)] = frame;
+}
+
+void LruKPolicy::frameFreed(const FrameId frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  if (!resident[frame]) {
+    return;
+  }
+  order.erase(orderKey(frame));
+  histories[frame].clear();
+  resident[frame] = false;
+}
+
+bool LruKPolicy::pickFirst(VictimCheck& check, std::uint32_t window,
+                           FrameId& frame) {
+  for (std::map<OrderKey, FrameId>::iterator it = order.begin();
+       it != order.end() && window > 0; ++it, window--) {
+    if (check.tryClaim(it->second)) {
+      frame = it->second;
+      order.erase(it);
+      retain(frame);
+      resident[frame] = false;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool LruKPolicy::pickVictim(const File* file, const PageId pageNo,
+                            VictimCheck& check, FrameId& frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  return pickFirst(check, order.size(), frame);
+}
+
+bool LruKPolicy::probeVictim(const File* file, const PageId pageNo,
+                             VictimCheck& check, const std::uint32_t window,
+                             FrameId& frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  return pickFirst(check, window, frame);
+}
+
+}
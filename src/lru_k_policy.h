@@ -0,0 +1,161 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief LRU-K replacement (O'Neil, O'Neil and Weikum).
+ *
+ * Evicts the page whose K-th most recent reference is oldest.  Pages with
+ * fewer than K references are evicted first, least recently used first, so a
+ * single sequential scan can't push out pages that are referenced repeatedly.
+ * Reference history of evicted pages is retained for up to numBufs pages.
+ */
+class LruKPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructs an LRU-K policy.
+   *
+   * @param numBufs   Number of frames in the buffer pool
+   * @param k         Number of references remembered per page
+   */
+  LruKPolicy(const std::uint32_t numBufs, const std::uint32_t k = 2);
+
+  const char* name() const override { return "LRU-K"; }
+
+  void frameLoaded(const FrameId frame, const File* file,
+                   const PageId pageNo) override;
+
+  void frameAccessed(const FrameId frame) override;
+
+  void frameFreed(const FrameId frame) override;
+
+  void resize(const std::uint32_t numBufs) override;
+
+  bool pickVictim(const File* file, const PageId pageNo,
+                  VictimCheck& check, FrameId& frame) override;
+
+  bool probeVictim(const File* file, const PageId pageNo, VictimCheck& check,
+                   const std::uint32_t window, FrameId& frame) override;
+
+ private:
+  /**
+   * Position of a frame in the eviction order: its K-th most recent
+   * reference time (0 if it has fewer than K) and its last reference time.
+   */
+  typedef std::pair<std::uint64_t, std::uint64_t> OrderKey;
+
+  /**
+   * Reference times of a page, most recent first, at most k entries.
+   */
+  typedef std::vector<std::uint64_t> History;
+
+  /**
+   * History of a page that is no longer resident.
+   */
+  struct RetainedHistory {
+    History history;
+    std::list<PageKey>::iterator pos;
+  };
+
+  /**
+   * Returns the position of a resident frame in the eviction order.
+   *
+   * @param frame   Resident frame
+   * @return  Key of the frame in order.
+   */
+  OrderKey orderKey(const FrameId frame) const;
+
+  /**
+   * Tries to claim one of the first window frames in eviction order.  The
+   * latch must be held.
+   *
+   * @param check   Used to claim candidate frames
+   * @param window  Most frames offered to check
+   * @param frame   Victim frame, set on success
+   * @return  True if a frame was claimed.
+   */
+  bool pickFirst(VictimCheck& check, std::uint32_t window, FrameId& frame);
+
+  /**
+   * Records a reference at the current time in the history.
+   *
+   * @param history   History to update
+   */
+  void reference(History& history);
+
+  /**
+   * Remembers the history of a page that leaves the pool, forgetting the
+   * oldest retained page if more than numBufs are retained.
+   *
+   * @param frame   Frame whose page is leaving
+   */
+  void retain(const FrameId frame);
+
+  /**
+   * Protects all members below
+   */
+  std::mutex latch;
+
+  /**
+   * Number of frames in the buffer pool
+   */
+  std::uint32_t numBufs;
+
+  /**
+   * Number of references remembered per page
+   */
+  std::uint32_t k;
+
+  /**
+   * Logical time, advanced on every reference
+   */
+  std::uint64_t now;
+
+  /**
+   * Whether each frame is tracked
+   */
+  std::vector<bool> resident;
+
+  /**
+   * Page held by each tracked frame
+   */
+  std::vector<PageKey> keys;
+
+  /**
+   * Reference history of each tracked frame
+   */
+  std::vector<History> histories;
+
+  /**
+   * Tracked frames in eviction order, best victim first
+   */
+  std::map<OrderKey, FrameId> order;
+
+  /**
+   * Histories of evicted pages
+   */
+  std::unordered_map<PageKey, RetainedHistory, PageKeyHash> retained;
+
+  /**
+   * Evicted pages with retained history, most recently evicted first
+   */
+  std::list<PageKey> retainedOrder;
+};
+
+}
@@ -13,16 +13,31 @@
 //#include <stdio.h>
 #include <cstring>
 #include <memory>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "page.h"
 #include "buffer.h"
 #include "file_iterator.h"
 #include "page_iterator.h"
+#include "mmap_file_io.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
+#include "exceptions/invalid_file_format_exception.h"
 #include "exceptions/invalid_page_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/invalid_record_exception.h"
+#include "exceptions/hash_already_present_exception.h"
+#include "exceptions/hash_not_found_exception.h"
 
 #define PRINT_ERROR(str) \
 { \
@@ -33,6 +48,56 @@
 
 using namespace badgerdb;
 
+/**
+ * Number of heap allocations this thread made while counting them, so tests
+ * can check that pages are passed around without allocating.
+ */
+thread_local std::size_t heapAllocations = 0;
+
+/**
+ * Whether the operator new below counts this thread's allocations, see
+ * CountAllocations
+ */
+thread_local bool countAllocations = false;
+
+/**
+ * Counts the heap allocations of the current thread while in scope.  Only
+ * the tests that check allocations use it, so the rest of the driver and
+ * the buffer manager's own threads aren't counted.
+ */
+class CountAllocations
+{
+public:
+	CountAllocations()
+	{
+		countAllocations = true;
+	}
+
+	~CountAllocations()
+	{
+		countAllocations = false;
+	}
+};
+
+void* operator new(std::size_t size)
+{
+	if (countAllocations)
+	{
+		heapAllocations++;
+	}
+	void* p = malloc(size == 0 ? 1 : size);
+	if (p == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
 const PageId num = 100;
 PageId pid[num], pageno1, pageno2, pageno3, i;
 RecordId rid[num], rid2, rid3;
@@ -41,6 +106,99 @@ char tmpbuf[100];
 BufMgr* bufMgr;
 File *file1ptr, *file2ptr, *file3ptr, *file4ptr, *file5ptr, *file6ptr, *file7ptr, *file8ptr;
 
+/**
+ * The chained hash table BufHashTbl used before it switched to Robin Hood
+ * buckets, kept here so test 38 can compare the two.  Every entry is a heap
+ * allocated node on the chain of its bucket, and buckets share NUM_PARTITIONS
+ * latches.
+ */
+class ChainedHashTbl
+{
+ public:
+	ChainedHashTbl(const int htSize) : HTSIZE(htSize), ht(new Node*[htSize]())
+	{
+	}
+
+	~ChainedHashTbl()
+	{
+		for (int index = 0; index < HTSIZE; index++)
+		{
+			while (ht[index])
+			{
+				Node* next = ht[index]->next;
+				delete ht[index];
+				ht[index] = next;
+			}
+		}
+		delete [] ht;
+	}
+
+	bool tryInsert(const File* file, const PageId pageNo, const FrameId frameNo)
+	{
+		const int index = hash(file, pageNo);
+		std::lock_guard<std::mutex> guard(latches[index % BufHashTbl::NUM_PARTITIONS]);
+		for (Node* node = ht[index]; node; node = node->next)
+		{
+			if (node->file == file && node->pageNo == pageNo)
+			{
+				return false;
+			}
+		}
+		ht[index] = new Node{file, pageNo, frameNo, ht[index]};
+		return true;
+	}
+
+	bool tryLookup(const File* file, const PageId pageNo, FrameId &frameNo)
+	{
+		const int index = hash(file, pageNo);
+		std::lock_guard<std::mutex> guard(latches[index % BufHashTbl::NUM_PARTITIONS]);
+		for (Node* node = ht[index]; node; node = node->next)
+		{
+			if (node->file == file && node->pageNo == pageNo)
+			{
+				frameNo = node->frameNo;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool tryRemove(const File* file, const PageId pageNo)
+	{
+		const int index = hash(file, pageNo);
+		std::lock_guard<std::mutex> guard(latches[index % BufHashTbl::NUM_PARTITIONS]);
+		for (Node** link = &ht[index]; *link; link = &(*link)->next)
+		{
+			if ((*link)->file == file && (*link)->pageNo == pageNo)
+			{
+				Node* node = *link;
+				*link = node->next;
+				delete node;
+				return true;
+			}
+		}
+		return false;
+	}
+
+ private:
+	struct Node
+	{
+		const File* file;
+		PageId pageNo;
+		FrameId frameNo;
+		Node* next;
+	};
+
+	int hash(const File* file, const PageId pageNo) const
+	{
+		return ((long)file + pageNo) % HTSIZE;
+	}
+
+	const int HTSIZE;
+	Node** ht;
+	std::mutex latches[BufHashTbl::NUM_PARTITIONS];
+};
+
 void test1();
 void test2();
 void test3();
@@ -52,6 +210,38 @@ void testBen8();
 void testBen9();
 void testBen10();
 void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
+void test26();
+void test27();
+void test28();
+void test29();
+void test30();
+void test31();
+void test32();
+void test33();
+void test34();
+void test35();
+void test36();
+void test37();
+void test38();
+void test39();
+void test40();
+void test41();
+void test42();
+void test43();
 void testBufMgr();
 
 int main() 
@@ -204,6 +394,39 @@ void testBufMgr()
 
 	delete bufMgr;
 
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
+	test17();
+	test18();
+	test19();
+	test20();
+	test21();
+	test22();
+	test23();
+	test24();
+	test25();
+	test26();
+	test27();
+	test28();
+	test29();
+	test30();
+	test31();
+	test32();
+	test33();
+	test34();
+	test35();
+	test36();
+	test37();
+	test38();
+	test39();
+	test40();
+	test41();
+	test42();
+	test43();
+
 	std::cout << "\n" << "Passed all tests." << "\n";
 }
 
@@ -478,3 +701,3450 @@ try
 	}
   std::cout << "Test 11 passed.";
 }
+
+void test12()
+{
+	// Readers on a pool smaller than the file, so that threads keep missing and
+	// evicting each other's pages.  Scale from 1 reader up to the number of cores.
+	const std::string& filename = "test.12";
+	const PageId numPages = num;
+	const int readsPerThread = 20000;
+	const unsigned maxThreads = std::max(2u, std::min(8u, std::thread::hardware_concurrency()));
+	RecordId rids[numPages + 1];
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file12 = File::create(filename);
+		BufMgr* mgr = new BufMgr(num / 4);
+
+		for (PageId j = 0; j < numPages; j++)
+		{
+			PageId pageNo;
+			Page* p;
+			mgr->allocPage(&file12, pageNo, p);
+			sprintf((char*)tmpbuf, "test.12 Page %u %7.1f", pageNo, (float)pageNo);
+			rids[pageNo] = p->insertRecord(tmpbuf);
+			mgr->unPinPage(&file12, pageNo, true);
+		}
+
+		for (unsigned numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+		{
+			std::atomic<bool> failed(false);
+			std::vector<std::thread> readers;
+			const auto start = std::chrono::steady_clock::now();
+			for (unsigned t = 0; t < numThreads; t++)
+			{
+				readers.push_back(std::thread([&, t]()
+				{
+					std::minstd_rand rng(t + 1);
+					char expected[100];
+					for (int j = 0; j < readsPerThread; j++)
+					{
+						const PageId pageNo = 1 + rng() % numPages;
+						Page* p;
+						mgr->readPage(&file12, pageNo, p);
+						sprintf(expected, "test.12 Page %u %7.1f", pageNo, (float)pageNo);
+						if (strncmp(p->getRecord(rids[pageNo]).c_str(), expected, strlen(expected)) != 0)
+						{
+							failed = true;
+						}
+						mgr->unPinPage(&file12, pageNo, false);
+					}
+				}));
+			}
+			for (std::thread& reader : readers)
+			{
+				reader.join();
+			}
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			if (failed)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			std::cout << "Test 12: " << numThreads << " reader(s), "
+				<< (long)(numThreads * readsPerThread / elapsed.count()) << " reads/s" << "\n";
+		}
+
+		mgr->flushFile(&file12);
+		delete mgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 12 passed" << "\n";
+}
+
+void test13()
+{
+	// A small hot set of pages read between sequential scans of the whole
+	// file, once per replacement policy.  Scan resistant policies should keep
+	// the hot set in the pool and report a higher hit ratio than CLOCK.
+	const std::string& filename = "test.13";
+	const PageId numPages = num;
+	const PageId hotPages = 15;
+	const ReplacementPolicyType policies[] = {ReplacementPolicyType::CLOCK,
+		ReplacementPolicyType::LRU_K, ReplacementPolicyType::TWO_Q, ReplacementPolicyType::ARC};
+	RecordId rids[numPages + 1];
+	double clockHitRatio = 0;
+
+	for (const ReplacementPolicyType policyType : policies)
+	{
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+
+		{
+			File file13 = File::create(filename);
+			BufMgr* mgr = new BufMgr(num / 4, policyType);
+
+			for (PageId j = 0; j < numPages; j++)
+			{
+				PageId pageNo;
+				Page* p;
+				mgr->allocPage(&file13, pageNo, p);
+				sprintf((char*)tmpbuf, "test.13 Page %u %7.1f", pageNo, (float)pageNo);
+				rids[pageNo] = p->insertRecord(tmpbuf);
+				mgr->unPinPage(&file13, pageNo, true);
+			}
+			if (mgr->getBufStats().allocs != (int)numPages || mgr->getBufStats().diskreads != 0)
+			{
+				PRINT_ERROR("ERROR :: New pages should be counted as allocations, not reads.");
+			}
+			mgr->clearBufStats();
+
+			// two threads run the same workload so the policy is also used concurrently
+			std::atomic<bool> failed(false);
+			std::vector<std::thread> readers;
+			for (unsigned t = 0; t < 2; t++)
+			{
+				readers.push_back(std::thread([&, t]()
+				{
+					std::minstd_rand rng(t + 1);
+					char expected[100];
+					for (int round = 0; round < 20; round++)
+					{
+						for (PageId j = 0; j < numPages; j++)
+						{
+							// every scanned page is followed by three reads of hot pages
+							for (int k = 0; k < 4; k++)
+							{
+								const PageId pageNo = k == 0 ? 1 + j : 1 + rng() % hotPages;
+								Page* p;
+								mgr->readPage(&file13, pageNo, p);
+								sprintf(expected, "test.13 Page %u %7.1f", pageNo, (float)pageNo);
+								if (strncmp(p->getRecord(rids[pageNo]).c_str(), expected, strlen(expected)) != 0)
+								{
+									failed = true;
+								}
+								mgr->unPinPage(&file13, pageNo, false);
+							}
+						}
+					}
+				}));
+			}
+			for (std::thread& reader : readers)
+			{
+				reader.join();
+			}
+			if (failed)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			const double hitRatio = mgr->getBufStats().hitRatio();
+			std::cout << "Test 13: " << mgr->policyName() << " hit ratio " << hitRatio << "\n";
+			if (policyType == ReplacementPolicyType::CLOCK)
+			{
+				clockHitRatio = hitRatio;
+			}
+			else if (hitRatio <= clockHitRatio)
+			{
+				PRINT_ERROR("ERROR :: Scan resistant policy did no better than CLOCK.");
+			}
+
+			mgr->flushFile(&file13);
+			delete mgr;
+		}
+		File::remove(filename);
+	}
+
+	std::cout << "Test 13 passed" << "\n";
+}
+
+void test14()
+{
+	// Random reads that dirty half of the pages they touch, on a pool smaller
+	// than the file, first without and then with the background writer.  With
+	// the writer running eviction should mostly find clean victims.  Once the
+	// writer is idle, it must have left no dirty page behind.
+	const std::string& filename = "test.14";
+	const PageId numPages = num;
+	const int reads = 20000;
+	RecordId rids[numPages + 1];
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file14 = File::create(filename);
+		BufMgr* mgr = new BufMgr(num / 4);
+
+		for (PageId j = 0; j < numPages; j++)
+		{
+			PageId pageNo;
+			Page* p;
+			mgr->allocPage(&file14, pageNo, p);
+			sprintf((char*)tmpbuf, "test.14 Page %u %7.1f", pageNo, (float)pageNo);
+			rids[pageNo] = p->insertRecord(tmpbuf);
+			mgr->unPinPage(&file14, pageNo, true);
+		}
+
+		for (int withWriter = 0; withWriter < 2; withWriter++)
+		{
+			if (withWriter)
+			{
+				// clean every dirty unpinned page
+				BgWriterConfig config;
+				config.highWatermark = 0;
+				config.lowWatermark = 0;
+				config.intervalMillis = 1;
+				mgr->startBackgroundWriter(config);
+			}
+			mgr->clearBufStats();
+
+			std::minstd_rand rng(1);
+			char expected[100];
+			for (int j = 0; j < reads; j++)
+			{
+				const PageId pageNo = 1 + rng() % numPages;
+				Page* p;
+				mgr->readPage(&file14, pageNo, p);
+				sprintf(expected, "test.14 Page %u %7.1f", pageNo, (float)pageNo);
+				if (strncmp(p->getRecord(rids[pageNo]).c_str(), expected, strlen(expected)) != 0)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+				mgr->unPinPage(&file14, pageNo, j % 2 == 0);
+			}
+
+			mgr->waitForBackgroundWriter();
+			mgr->stopBackgroundWriter();
+			BufStats& stats = mgr->getBufStats();
+			std::cout << "Test 14: " << (withWriter ? "with" : "without") << " background writer, "
+				<< stats.diskwrites << " writes (" << stats.bgwrites << " in background), "
+				<< stats.stallMicros << " us stalled" << "\n";
+			if (!withWriter && stats.bgwrites != 0)
+			{
+				PRINT_ERROR("ERROR :: Background writes without a background writer.");
+			}
+			if (withWriter && stats.bgwrites == 0)
+			{
+				PRINT_ERROR("ERROR :: Background writer wrote nothing.");
+			}
+			// with the writer idle every page in the pool is clean, so there is
+			// nothing left for flushFile to write
+			const int written = stats.diskwrites;
+			mgr->flushFile(&file14);
+			if (withWriter != (stats.diskwrites == written))
+			{
+				PRINT_ERROR("ERROR :: Background writer left dirty pages behind.");
+			}
+		}
+
+		mgr->flushFile(&file14);
+		delete mgr;
+
+		// everything written back, in the background or not, must read back intact
+		mgr = new BufMgr(num / 4);
+		for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+		{
+			Page* p;
+			mgr->readPage(&file14, pageNo, p);
+			sprintf((char*)tmpbuf, "test.14 Page %u %7.1f", pageNo, (float)pageNo);
+			if (strncmp(p->getRecord(rids[pageNo]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			mgr->unPinPage(&file14, pageNo, false);
+		}
+		delete mgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 14 passed" << "\n";
+}
+
+void test15()
+{
+	// Sequential scans that keep a window of prefetched pages ahead of the
+	// page being read, for several window sizes.  A window read ahead before
+	// the scan starts must be resident, so the scan hits all of it.
+	const std::string& filename = "test.15";
+	const PageId numPages = 10 * num;
+	const PageId poolSize = 2 * num;
+	const PageId depths[] = {0, 8, 32, 128};
+	std::vector<RecordId> rids(numPages + 1);
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file15 = File::create(filename);
+		BufMgr* mgr = new BufMgr(poolSize);
+
+		for (PageId j = 0; j < numPages; j++)
+		{
+			PageId pageNo;
+			Page* p;
+			mgr->allocPage(&file15, pageNo, p);
+			sprintf((char*)tmpbuf, "test.15 Page %u %7.1f", pageNo, (float)pageNo);
+			rids[pageNo] = p->insertRecord(tmpbuf);
+			mgr->unPinPage(&file15, pageNo, true);
+		}
+
+		for (const PageId depth : depths)
+		{
+			if (depth > 0)
+			{
+				mgr->flushFile(&file15);
+				mgr->clearBufStats();
+				mgr->prefetch(&file15, 1, depth);
+				mgr->waitForPrefetches();
+				for (PageId pageNo = 1; pageNo <= depth; pageNo++)
+				{
+					Page* p;
+					mgr->readPage(&file15, pageNo, p);
+					mgr->unPinPage(&file15, pageNo, false);
+				}
+				BufStats& stats = mgr->getBufStats();
+				if (stats.prefetches != (int)depth || stats.diskreads != (int)depth || stats.hits != (int)depth)
+				{
+					PRINT_ERROR("ERROR :: Pages read ahead were not all hits.");
+				}
+			}
+
+			// start every scan with none of the file in the pool
+			mgr->flushFile(&file15);
+			mgr->clearBufStats();
+
+			const auto start = std::chrono::steady_clock::now();
+			if (depth > 0)
+			{
+				mgr->prefetch(&file15, 1, depth);
+			}
+			for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+			{
+				if (depth > 0 && pageNo + depth <= numPages)
+				{
+					mgr->prefetch(&file15, pageNo + depth, 1);
+				}
+				Page* p;
+				mgr->readPage(&file15, pageNo, p);
+				sprintf((char*)tmpbuf, "test.15 Page %u %7.1f", pageNo, (float)pageNo);
+				if (strncmp(p->getRecord(rids[pageNo]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+				mgr->unPinPage(&file15, pageNo, false);
+			}
+			const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+			BufStats& stats = mgr->getBufStats();
+			std::cout << "Test 15: prefetch depth " << depth << ", " << elapsed.count() << " ms, "
+				<< stats.hits << " hits, " << stats.diskreads << " reads (" << stats.prefetches << " prefetched)" << "\n";
+			if (depth == 0 && stats.diskreads != (int)numPages)
+			{
+				PRINT_ERROR("ERROR :: Every page should have been read exactly once.");
+			}
+			// the scan reads every page once, so only prefetched pages can hit
+			if (stats.hits > stats.prefetches)
+			{
+				PRINT_ERROR("ERROR :: Scan hits should come from prefetched pages.");
+			}
+		}
+
+		mgr->flushFile(&file15);
+		delete mgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 15 passed" << "\n";
+}
+
+void test16()
+{
+	// Point lookups over a small hot set while another thread keeps scanning a
+	// file much larger than the pool, once with the scan going through the
+	// shared pool and once with it confined to a ring.  The scanned file never
+	// fits in the pool, so the hits are those of the point lookups.
+	const std::string& hotName = "test.16a";
+	const std::string& scanName = "test.16b";
+	const PageId hotPages = 20;
+	const PageId scanPages = 5 * num;
+	const int lookups = 20000;
+	RecordId hotRids[hotPages + 1];
+	std::vector<RecordId> scanRids(scanPages + 1);
+	double hitRatios[2];
+
+	for (const std::string& filename : {hotName, scanName})
+	{
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+	}
+
+	{
+		File hotFile = File::create(hotName);
+		File scanFile = File::create(scanName);
+		BufMgr* mgr = new BufMgr(num / 2);
+
+		for (PageId j = 0; j < hotPages; j++)
+		{
+			PageId pageNo;
+			Page* p;
+			mgr->allocPage(&hotFile, pageNo, p);
+			sprintf((char*)tmpbuf, "test.16a Page %u %7.1f", pageNo, (float)pageNo);
+			hotRids[pageNo] = p->insertRecord(tmpbuf);
+			mgr->unPinPage(&hotFile, pageNo, true);
+		}
+		for (PageId j = 0; j < scanPages; j++)
+		{
+			PageId pageNo;
+			Page* p;
+			mgr->allocPage(&scanFile, pageNo, p);
+			sprintf((char*)tmpbuf, "test.16b Page %u %7.1f", pageNo, (float)pageNo);
+			scanRids[pageNo] = p->insertRecord(tmpbuf);
+			mgr->unPinPage(&scanFile, pageNo, true);
+		}
+
+		for (int useRing = 0; useRing < 2; useRing++)
+		{
+			mgr->flushFile(&hotFile);
+			mgr->flushFile(&scanFile);
+			mgr->clearBufStats();
+
+			std::atomic<bool> done(false);
+			std::atomic<bool> failed(false);
+			std::thread scanner([&]()
+			{
+				BufferRing ring;
+				char expected[100];
+				while (!done)
+				{
+					for (PageId pageNo = 1; pageNo <= scanPages && !done; pageNo++)
+					{
+						Page* p;
+						if (useRing)
+						{
+							mgr->readPage(&scanFile, pageNo, p, ring);
+						}
+						else
+						{
+							mgr->readPage(&scanFile, pageNo, p);
+						}
+						sprintf(expected, "test.16b Page %u %7.1f", pageNo, (float)pageNo);
+						if (strncmp(p->getRecord(scanRids[pageNo]).c_str(), expected, strlen(expected)) != 0)
+						{
+							failed = true;
+						}
+						mgr->unPinPage(&scanFile, pageNo, false);
+					}
+				}
+			});
+
+			std::minstd_rand rng(1);
+			char expected[100];
+			for (int j = 0; j < lookups; j++)
+			{
+				const PageId pageNo = 1 + rng() % hotPages;
+				Page* p;
+				mgr->readPage(&hotFile, pageNo, p);
+				sprintf(expected, "test.16a Page %u %7.1f", pageNo, (float)pageNo);
+				if (strncmp(p->getRecord(hotRids[pageNo]).c_str(), expected, strlen(expected)) != 0)
+				{
+					failed = true;
+				}
+				mgr->unPinPage(&hotFile, pageNo, false);
+				// let the scan make progress between lookups even on one core
+				std::this_thread::yield();
+			}
+			done = true;
+			scanner.join();
+			if (failed)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+
+			hitRatios[useRing] = (double)mgr->getBufStats().hits / lookups;
+			std::cout << "Test 16: scan " << (useRing ? "in a ring" : "in the shared pool")
+				<< ", point lookup hit ratio " << hitRatios[useRing] << "\n";
+		}
+		// in a ring the scan only ever evicts its own pages, so the hot set
+		// misses once per page and then stays resident
+		if (hitRatios[1] < 0.95 || hitRatios[1] <= hitRatios[0])
+		{
+			PRINT_ERROR("ERROR :: Scan in a ring evicted pages of the hot set.");
+		}
+
+		mgr->flushFile(&hotFile);
+		mgr->flushFile(&scanFile);
+		delete mgr;
+	}
+	File::remove(hotName);
+	File::remove(scanName);
+
+	std::cout << "Test 16 passed" << "\n";
+}
+
+void test17()
+{
+	// PageHandle: pages are unpinned when their handles go away, dirty pages
+	// written back, and the hit path compared with readPage()/unPinPage().
+	const std::string& filename = "test.17";
+	const PageId numPages = 10;
+	const int accesses = 200000;
+	RecordId rids[numPages + 1];
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file17 = File::create(filename);
+		BufMgr* mgr = new BufMgr(num);
+
+		for (PageId j = 0; j < numPages; j++)
+		{
+			PageHandle handle = mgr->allocPage(&file17);
+			sprintf((char*)tmpbuf, "test.17 Page %u %7.1f", handle.pageNo(), (float)handle.pageNo());
+			rids[handle.pageNo()] = handle->insertRecord(tmpbuf);
+			handle.markDirty();
+		}
+
+		{
+			// moving keeps a single pin, which the last owner releases
+			PageHandle first = mgr->readPage(&file17, 1);
+			PageHandle second(std::move(first));
+			if (first || !second)
+			{
+				PRINT_ERROR("ERROR :: Moved-from handle should be empty.");
+			}
+			first = mgr->readPage(&file17, 2);
+			first = std::move(second);
+			if (first.pageNo() != 1 || second)
+			{
+				PRINT_ERROR("ERROR :: Handle should hold the page moved into it.");
+			}
+		}
+
+		{
+			// a page unpinned behind the handle's back can't be unpinned again
+			PageHandle handle = mgr->readPage(&file17, 1);
+			mgr->unPinPage(&file17, 1, false);
+			try
+			{
+				handle.release();
+				PRINT_ERROR("ERROR :: Page was unpinned twice.");
+			}
+			catch(const PageNotPinnedException &e)
+			{
+			}
+			if (handle)
+			{
+				PRINT_ERROR("ERROR :: Handle should be empty after a failed release.");
+			}
+
+			// nor may the handle drop the pin of a page since put in its frame
+			handle = mgr->readPage(&file17, 1);
+			mgr->unPinPage(&file17, 1, false);
+			mgr->flushFile(&file17);
+			Page* p;
+			mgr->readPage(&file17, 2, p);
+			try
+			{
+				handle.release();
+				PRINT_ERROR("ERROR :: Handle unpinned a page it did not pin.");
+			}
+			catch(const PageNotPinnedException &e)
+			{
+			}
+			mgr->unPinPage(&file17, 2, false);
+		}
+
+		// no handle is left, so nothing may be pinned
+		mgr->flushFile(&file17);
+
+		for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+		{
+			PageHandle handle = mgr->readPage(&file17, pageNo);
+			sprintf((char*)tmpbuf, "test.17 Page %u %7.1f", pageNo, (float)pageNo);
+			if (strncmp(handle->getRecord(rids[pageNo]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+
+		std::minstd_rand rng(1);
+		auto start = std::chrono::steady_clock::now();
+		for (int j = 0; j < accesses; j++)
+		{
+			const PageId pageNo = 1 + rng() % numPages;
+			Page* p;
+			mgr->readPage(&file17, pageNo, p);
+			mgr->unPinPage(&file17, pageNo, false);
+		}
+		const std::chrono::duration<double, std::nano> withLookup = std::chrono::steady_clock::now() - start;
+
+		start = std::chrono::steady_clock::now();
+		for (int j = 0; j < accesses; j++)
+		{
+			const PageId pageNo = 1 + rng() % numPages;
+			PageHandle handle = mgr->readPage(&file17, pageNo);
+		}
+		const std::chrono::duration<double, std::nano> withHandle = std::chrono::steady_clock::now() - start;
+
+		std::cout << "Test 17: readPage/unPinPage " << withLookup.count() / accesses << " ns, PageHandle "
+			<< withHandle.count() / accesses << " ns per hit" << "\n";
+
+		mgr->flushFile(&file17);
+		delete mgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 17 passed" << "\n";
+}
+
+void test18()
+{
+	// A large pool is one aligned region that is not touched until used, so
+	// it starts up quickly; frames are exactly one on-disk page apart.
+	const std::uint32_t largeBufs = 1 << 16;
+	const std::string& filename = "test.18";
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file18 = File::create(filename);
+		for (int hugePages = 0; hugePages < 2; hugePages++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			BufMgr* mgr = new BufMgr(largeBufs, ReplacementPolicyType::CLOCK, hugePages);
+			const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			std::cout << "Test 18: " << largeBufs << " frame pool" << (hugePages ? " with huge pages" : "")
+				<< " constructed in " << elapsed.count() << " ms" << "\n";
+
+			const std::uintptr_t pool = reinterpret_cast<std::uintptr_t>(mgr->bufPool);
+			if (pool % 4096 != 0 || (hugePages && pool % (2 * 1024 * 1024) != 0))
+			{
+				PRINT_ERROR("ERROR :: Buffer pool is not aligned.");
+			}
+			if (reinterpret_cast<char*>(&mgr->bufPool[1]) - reinterpret_cast<char*>(&mgr->bufPool[0]) != (std::ptrdiff_t)Page::SIZE)
+			{
+				PRINT_ERROR("ERROR :: Frames are not Page::SIZE bytes apart.");
+			}
+
+			PageId pageNo;
+			Page* p;
+			mgr->allocPage(&file18, pageNo, p);
+			sprintf((char*)tmpbuf, "test.18 Page %u %7.1f", pageNo, (float)pageNo);
+			const RecordId rid18 = p->insertRecord(tmpbuf);
+			mgr->unPinPage(&file18, pageNo, true);
+			mgr->flushFile(&file18);
+			mgr->readPage(&file18, pageNo, p);
+			if (strncmp(p->getRecord(rid18).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			mgr->unPinPage(&file18, pageNo, false);
+			mgr->flushFile(&file18);
+			delete mgr;
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 18 passed" << "\n";
+}
+
+// Reads the read system call count and bytes read by this process so far
+// from /proc/self/io.  Returns false where that is not available.
+bool readProcIo(long long& syscalls, long long& bytes)
+{
+	std::ifstream io("/proc/self/io");
+	std::string key;
+	long long value;
+	syscalls = bytes = -1;
+	while (io >> key >> value)
+	{
+		if (key == "syscr:")
+		{
+			syscalls = value;
+		}
+		else if (key == "rchar:")
+		{
+			bytes = value;
+		}
+	}
+	return syscalls >= 0 && bytes >= 0;
+}
+
+void test19()
+{
+	// Every read misses: count the read system calls and bytes read per miss.
+	const std::string& filename = "test.19";
+	const PageId numPages = num;
+	RecordId rids[numPages + 1];
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file19 = File::create(filename);
+		BufMgr* mgr = new BufMgr(num / 10);
+
+		for (PageId j = 0; j < numPages; j++)
+		{
+			PageId pageNo;
+			Page* p;
+			mgr->allocPage(&file19, pageNo, p);
+			sprintf((char*)tmpbuf, "test.19 Page %u %7.1f", pageNo, (float)pageNo);
+			rids[pageNo] = p->insertRecord(tmpbuf);
+			mgr->unPinPage(&file19, pageNo, true);
+		}
+		mgr->flushFile(&file19);
+		mgr->clearBufStats();
+
+		long long syscallsBefore, bytesBefore, syscallsAfter, bytesAfter;
+		const bool haveProcIo = readProcIo(syscallsBefore, bytesBefore);
+		for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+		{
+			Page* p;
+			mgr->readPage(&file19, pageNo, p);
+			mgr->unPinPage(&file19, pageNo, false);
+		}
+		readProcIo(syscallsAfter, bytesAfter);
+
+		const int misses = mgr->getBufStats().diskreads;
+		if (misses != (int)numPages)
+		{
+			PRINT_ERROR("ERROR :: Every read should have missed.");
+		}
+		if (haveProcIo)
+		{
+			std::cout << "Test 19: " << (double)(syscallsAfter - syscallsBefore) / misses << " read syscalls, "
+				<< (double)(bytesAfter - bytesBefore) / misses << " bytes read per miss" << "\n";
+		}
+
+		for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+		{
+			Page* p;
+			mgr->readPage(&file19, pageNo, p);
+			sprintf((char*)tmpbuf, "test.19 Page %u %7.1f", pageNo, (float)pageNo);
+			if (strncmp(p->getRecord(rids[pageNo]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			mgr->unPinPage(&file19, pageNo, false);
+		}
+
+		// a page past the end of the file is still rejected
+		try
+		{
+			Page* p;
+			mgr->readPage(&file19, numPages + 1, p);
+			PRINT_ERROR("ERROR :: Page past the end of the file. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const InvalidPageException &e)
+		{
+		}
+
+		mgr->flushFile(&file19);
+		delete mgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 19 passed" << "\n";
+}
+
+void test20()
+{
+	// Threads reading random pages straight from a File, with each backend.
+	// The stream backend serializes every read; the descriptor backend
+	// lets them run in parallel.
+	const std::string& filename = "test.20";
+	const PageId numPages = num;
+	const int readsPerThread = 5000;
+	const unsigned maxThreads = std::max(2u, std::min(8u, std::thread::hardware_concurrency()));
+	const FileBackend backends[] = {FileBackend::STREAM, FileBackend::DESCRIPTOR};
+	RecordId rids[numPages + 1];
+
+	for (const FileBackend backend : backends)
+	{
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+
+		{
+			File file20 = File::create(filename, backend);
+			if (file20.backend() != backend)
+			{
+				PRINT_ERROR("ERROR :: File was not opened with the requested backend.");
+			}
+			for (PageId j = 0; j < numPages; j++)
+			{
+				Page new_page = file20.allocatePage();
+				sprintf((char*)tmpbuf, "test.20 Page %u %7.1f", new_page.page_number(), (float)new_page.page_number());
+				rids[new_page.page_number()] = new_page.insertRecord(tmpbuf);
+				file20.writePage(new_page);
+			}
+
+			for (unsigned numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+			{
+				std::atomic<bool> failed(false);
+				std::vector<std::thread> readers;
+				const auto start = std::chrono::steady_clock::now();
+				for (unsigned t = 0; t < numThreads; t++)
+				{
+					readers.push_back(std::thread([&, t]()
+					{
+						std::minstd_rand rng(t + 1);
+						char expected[100];
+						Page p;
+						for (int j = 0; j < readsPerThread; j++)
+						{
+							const PageId pageNo = 1 + rng() % numPages;
+							file20.readPage(pageNo, p);
+							sprintf(expected, "test.20 Page %u %7.1f", pageNo, (float)pageNo);
+							if (strncmp(p.getRecord(rids[pageNo]).c_str(), expected, strlen(expected)) != 0)
+							{
+								failed = true;
+							}
+						}
+					}));
+				}
+				for (std::thread& reader : readers)
+				{
+					reader.join();
+				}
+				const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+				if (failed)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+				std::cout << "Test 20: " << (backend == FileBackend::STREAM ? "stream" : "descriptor") << " backend, "
+					<< numThreads << " reader(s), " << (long)(numThreads * readsPerThread / elapsed.count()) << " reads/s" << "\n";
+			}
+
+			// the buffer manager works the same on either backend
+			BufMgr* mgr = new BufMgr(num / 4);
+			for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+			{
+				Page* p;
+				mgr->readPage(&file20, pageNo, p);
+				p->insertRecord("test.20 second record");
+				mgr->unPinPage(&file20, pageNo, true);
+			}
+			mgr->flushFile(&file20);
+			delete mgr;
+			for (FileIterator iter = file20.begin(); iter != file20.end(); ++iter)
+			{
+				const PageId pageNo = (*iter).page_number();
+				sprintf((char*)tmpbuf, "test.20 Page %u %7.1f", pageNo, (float)pageNo);
+				if (strncmp((*iter).getRecord(rids[pageNo]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+			}
+		}
+		File::remove(filename);
+	}
+
+	std::cout << "Test 20 passed" << "\n";
+}
+
+void test21()
+{
+	// Bulk load a file spanning several map groups.  Allocating a page touches
+	// one map byte, the page and the header, so the last pages cost the same
+	// as the first ones.
+	const std::string& filename = "test.21";
+	const PageId numPages = 2 * File::PAGES_PER_MAP + 10000;
+	const PageId chunk = 10000;
+	const PageId deleteEvery = 1000;
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file21 = File::create(filename, FileBackend::DESCRIPTOR);
+		double firstChunk = 0, lastChunk = 0;
+		std::vector<PageId> pageNos;
+		Page new_page;
+		auto start = std::chrono::steady_clock::now();
+		for (PageId j = 0; j < numPages; j++)
+		{
+			if (j % chunk == 0)
+			{
+				start = std::chrono::steady_clock::now();
+			}
+			file21.allocatePage(new_page);
+			pageNos.push_back(new_page.page_number());
+			if (j % chunk == chunk - 1)
+			{
+				const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+				if (j < chunk)
+					firstChunk = elapsed.count() / chunk;
+				lastChunk = elapsed.count() / chunk;
+			}
+		}
+		std::cout << "Test 21: " << numPages << " pages allocated, " << firstChunk << " us per page for the first "
+			<< chunk << ", " << lastChunk << " us for the last " << chunk << "\n";
+
+		// pages are numbered in order, skipping one map page per group
+		for (PageId j = 1; j < numPages; j++)
+		{
+			if (pageNos[j] <= pageNos[j - 1])
+			{
+				PRINT_ERROR("ERROR :: Pages were not allocated in order.");
+			}
+		}
+
+		// deleted pages can't be read and are skipped by the iterator
+		for (PageId j = 0; j < numPages; j += deleteEvery)
+		{
+			file21.deletePage(pageNos[j]);
+			try
+			{
+				file21.readPage(pageNos[j]);
+				PRINT_ERROR("ERROR :: Deleted page read. Exception should have been thrown before execution reaches this point.");
+			}
+			catch(const InvalidPageException &e)
+			{
+			}
+		}
+		PageId visited = 0;
+		for (FileIterator iter = file21.begin(); iter != file21.end(); ++iter)
+		{
+			visited++;
+		}
+		if (visited != numPages - (numPages + deleteEvery - 1) / deleteEvery)
+		{
+			PRINT_ERROR("ERROR :: Iterator did not visit every used page.");
+		}
+
+		// freed pages are reused lowest first before the file grows again
+		for (PageId j = 0; j < numPages; j += deleteEvery)
+		{
+			file21.allocatePage(new_page);
+			if (new_page.page_number() != pageNos[j])
+			{
+				PRINT_ERROR("ERROR :: Free page was not reused.");
+			}
+		}
+		file21.allocatePage(new_page);
+		if (new_page.page_number() <= pageNos.back())
+		{
+			PRINT_ERROR("ERROR :: Page was not appended at the end of the file.");
+		}
+	}
+	File::remove(filename);
+
+	// files that are not in the current format are refused
+	{
+		std::ofstream garbage(filename.c_str());
+		garbage << "not a BadgerDB file";
+	}
+	try
+	{
+		File::open(filename);
+		PRINT_ERROR("ERROR :: Opened a file in an unknown format. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const InvalidFileFormatException &e)
+	{
+	}
+	File::remove(filename);
+
+	std::cout << "Test 21 passed" << "\n";
+}
+
+void test22()
+{
+	// The header and maps are cached while the file is open, so reading,
+	// writing, allocating, deleting and iterating over pages does no metadata
+	// I/O until the metadata is flushed.
+	const std::string& filename = "test.22";
+	const PageId numPages = num;
+	const PageId deleteEvery = 10;
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file22 = File::create(filename);
+		file22.clearStats();
+		for (PageId j = 0; j < numPages; j++)
+		{
+			file22.allocatePage();
+		}
+		FileStats stats = file22.stats();
+		std::cout << "Test 22: allocatePage " << (double)stats.page_writes / numPages << " page writes, "
+			<< (double)(stats.metadata_reads + stats.metadata_writes) / numPages << " metadata I/Os per page" << "\n";
+		if (stats.page_writes != numPages || stats.metadata_reads != 0 || stats.metadata_writes != 0)
+		{
+			PRINT_ERROR("ERROR :: allocatePage did more than one I/O per page.");
+		}
+
+		file22.clearStats();
+		for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+		{
+			Page p = file22.readPage(pageNo);
+			sprintf((char*)tmpbuf, "test.22 Page %u %7.1f", pageNo, (float)pageNo);
+			p.insertRecord(tmpbuf);
+			file22.writePage(p);
+		}
+		for (PageId pageNo = deleteEvery; pageNo <= numPages; pageNo += deleteEvery)
+		{
+			file22.deletePage(pageNo);
+		}
+		PageId visited = 0;
+		for (FileIterator iter = file22.begin(); iter != file22.end(); ++iter)
+		{
+			visited++;
+		}
+		stats = file22.stats();
+		std::cout << "Test 22: readPage/writePage/deletePage/iterate " << stats.metadata_reads + stats.metadata_writes
+			<< " metadata I/Os for " << stats.page_reads << " page reads and " << stats.page_writes << " page writes" << "\n";
+		if (stats.metadata_reads != 0 || stats.metadata_writes != 0 ||
+			stats.page_writes != numPages + numPages / deleteEvery || stats.page_reads != numPages ||
+			visited != numPages - numPages / deleteEvery)
+		{
+			PRINT_ERROR("ERROR :: Page access did metadata I/O.");
+		}
+
+		// one write for the map and one for the header, then nothing is left
+		file22.clearStats();
+		file22.flushMetadata();
+		file22.flushMetadata();
+		stats = file22.stats();
+		if (stats.metadata_writes != 2)
+		{
+			PRINT_ERROR("ERROR :: flushMetadata did not write exactly the map and the header.");
+		}
+
+		// flushFile writes the metadata after the pages
+		bufMgr = new BufMgr(num);
+		bufMgr->readPage(&file22, 1, page);
+		bufMgr->unPinPage(&file22, 1, true);
+		// reuses the first deleted page
+		file22.allocatePage();
+		file22.clearStats();
+		bufMgr->flushFile(&file22);
+		stats = file22.stats();
+		if (stats.page_writes != 1 || stats.metadata_writes != 2)
+		{
+			PRINT_ERROR("ERROR :: flushFile did not write the page and the metadata.");
+		}
+		delete bufMgr;
+	}
+
+	// closing the file wrote everything back
+	{
+		File file22 = File::open(filename);
+		PageId visited = 0;
+		for (FileIterator iter = file22.begin(); iter != file22.end(); ++iter)
+		{
+			const PageId pageNo = (*iter).page_number();
+			if (pageNo % deleteEvery == 0 && pageNo != deleteEvery)
+			{
+				PRINT_ERROR("ERROR :: Deleted page found after reopening the file.");
+			}
+			visited++;
+		}
+		if (visited != numPages - numPages / deleteEvery + 1)
+		{
+			PRINT_ERROR("ERROR :: Pages lost after reopening the file.");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 22 passed" << "\n";
+}
+
+void test23()
+{
+	// Scan a file through a read-only mapping, viewing pages and records in
+	// place, and compare with copying every page out of the descriptor
+	// backend.  Then update and grow the file through a writable mapping.
+	const std::string& filename = "test.23";
+	const PageId numPages = 20 * num;
+	const int scans = 5;
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file23 = File::create(filename, FileBackend::DESCRIPTOR);
+		for (PageId j = 0; j < numPages; j++)
+		{
+			Page new_page = file23.allocatePage();
+			sprintf((char*)tmpbuf, "test.23 Page %u %7.1f", new_page.page_number(), (float)new_page.page_number());
+			new_page.insertRecord(tmpbuf);
+			new_page.insertRecord("test.23 second record");
+			file23.writePage(new_page);
+		}
+		try
+		{
+			file23.viewPage(1);
+			PRINT_ERROR("ERROR :: Viewed a page of a file that is not mapped. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const FileIOException &e)
+		{
+		}
+
+		std::size_t copiedBytes = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (int k = 0; k < scans; k++)
+		{
+			for (FileIterator iter = file23.begin(); iter != file23.end(); ++iter)
+			{
+				const Page p = *iter;
+				for (PageIterator page_iter = p.begin(); page_iter != p.end(); ++page_iter)
+				{
+					copiedBytes += (*page_iter).length();
+				}
+			}
+		}
+		const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << "Test 23: descriptor backend, " << scans << " scans copying pages in " << elapsed.count() << " ms" << "\n";
+		if (copiedBytes == 0)
+		{
+			PRINT_ERROR("ERROR :: Scan found no records.");
+		}
+	}
+
+	{
+		File file23 = File::open(filename, FileBackend::MMAP_READ_ONLY);
+		file23.adviseAccess(AccessPattern::SEQUENTIAL);
+		PageId visited = 0;
+		std::size_t records = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (int k = 0; k < scans; k++)
+		{
+			for (FileIterator iter = file23.begin(); iter != file23.end(); ++iter)
+			{
+				const Page& p = iter.view();
+				for (PageIterator page_iter = p.begin(); page_iter != p.end(); ++page_iter)
+				{
+					records++;
+				}
+				visited++;
+			}
+		}
+		const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << "Test 23: read-only mapping, " << scans << " scans viewing pages in " << elapsed.count() << " ms" << "\n";
+		if (visited != scans * numPages || records != 2 * visited)
+		{
+			PRINT_ERROR("ERROR :: Iterator did not visit every page.");
+		}
+
+		file23.adviseAccess(AccessPattern::RANDOM);
+		std::minstd_rand rng(23);
+		for (PageId j = 0; j < numPages; j++)
+		{
+			const PageId pageNo = 1 + rng() % numPages;
+			const Page& p = file23.viewPage(pageNo);
+			sprintf((char*)tmpbuf, "test.23 Page %u %7.1f", pageNo, (float)pageNo);
+			if (p.page_number() != pageNo || strncmp((*p.begin()).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+		if (file23.stats().page_reads != 0)
+		{
+			PRINT_ERROR("ERROR :: Viewing pages read them.");
+		}
+
+		try
+		{
+			file23.allocatePage();
+			PRINT_ERROR("ERROR :: Allocated a page in a read-only file. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const FileIOException &e)
+		{
+		}
+	}
+
+	{
+		// views follow writes to the mapping, and the file grows in place
+		File file23 = File::open(filename, FileBackend::MMAP);
+		const Page& view = file23.viewPage(1);
+		Page p = file23.readPage(1);
+		p.insertRecord("test.23 third record");
+		file23.writePage(p);
+		if (view.getRecord({1, 3}) != "test.23 third record")
+		{
+			PRINT_ERROR("ERROR :: View did not show the written page.");
+		}
+		for (PageId j = 0; j < numPages; j++)
+		{
+			Page new_page = file23.allocatePage();
+			new_page.insertRecord("test.23 appended");
+			file23.writePage(new_page);
+		}
+		if (&file23.viewPage(1) != &view || (*file23.viewPage(2 * numPages).begin()) != "test.23 appended")
+		{
+			PRINT_ERROR("ERROR :: Mapping moved or missed appended pages.");
+		}
+		file23.sync();
+	}
+
+	{
+		File file23 = File::open(filename, FileBackend::STREAM);
+		PageId visited = 0;
+		for (FileIterator iter = file23.begin(); iter != file23.end(); ++iter)
+		{
+			visited++;
+		}
+		if (visited != 2 * numPages || file23.readPage(1).getRecord({1, 3}) != "test.23 third record")
+		{
+			PRINT_ERROR("ERROR :: Changes made through the mapping were lost.");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 23 passed" << "\n";
+}
+
+void test24()
+{
+	// Random page reads submitted in batches of increasing size.  The
+	// descriptor backend keeps a whole batch in flight through io_uring when
+	// the kernel has it; the stream backend always reads one page at a time.
+	const std::string& filename = "test.24";
+	const PageId numPages = 40 * num;
+	const std::size_t reads = 8192;
+	const std::size_t depths[] = {1, 4, 16, 64};
+	const FileBackend backends[] = {FileBackend::DESCRIPTOR, FileBackend::STREAM};
+
+	for (const FileBackend backend : backends)
+	{
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+
+		{
+			File file24 = File::create(filename, backend);
+			// written in batches too
+			std::vector<Page> batch(64);
+			std::vector<const Page*> batchPtrs;
+			for (PageId j = 0; j < numPages; j++)
+			{
+				Page& new_page = batch[batchPtrs.size()];
+				file24.allocatePage(new_page);
+				sprintf((char*)tmpbuf, "test.24 Page %u %7.1f", new_page.page_number(), (float)new_page.page_number());
+				new_page.insertRecord(tmpbuf);
+				batchPtrs.push_back(&new_page);
+				if (batchPtrs.size() == batch.size())
+				{
+					file24.writePages(batchPtrs.data(), batchPtrs.size());
+					batchPtrs.clear();
+				}
+			}
+			file24.writePages(batchPtrs.data(), batchPtrs.size());
+			file24.adviseAccess(AccessPattern::RANDOM);
+
+			std::vector<Page> pages(64);
+			std::vector<Page*> pagePtrs;
+			for (Page& p : pages)
+			{
+				pagePtrs.push_back(&p);
+			}
+			std::vector<PageId> pageNos(64);
+			for (const std::size_t depth : depths)
+			{
+				std::minstd_rand rng(depth);
+				const auto start = std::chrono::steady_clock::now();
+				for (std::size_t done = 0; done < reads; done += depth)
+				{
+					for (std::size_t k = 0; k < depth; k++)
+					{
+						pageNos[k] = 1 + rng() % numPages;
+					}
+					file24.readPages(pageNos.data(), pagePtrs.data(), depth);
+					for (std::size_t k = 0; k < depth; k++)
+					{
+						sprintf((char*)tmpbuf, "test.24 Page %u %7.1f", pageNos[k], (float)pageNos[k]);
+						if (strncmp((*pages[k].begin()).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+						{
+							PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+						}
+					}
+				}
+				const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+				std::cout << "Test 24: " << (backend == FileBackend::STREAM ? "stream" : "descriptor")
+					<< (file24.asynchronousBatches() ? " (io_uring)" : " (synchronous)") << " backend, queue depth " << depth
+					<< ", " << (long)(reads / elapsed.count()) << " reads/s" << "\n";
+			}
+
+			// pages past the end are reported, not read
+			pageNos[0] = 1;
+			pageNos[1] = numPages + 100;
+			bool valid[2];
+			file24.readPages(pageNos.data(), pagePtrs.data(), 2, valid);
+			if (!valid[0] || valid[1])
+			{
+				PRINT_ERROR("ERROR :: Batched read misreported a page.");
+			}
+			try
+			{
+				file24.readPages(pageNos.data(), pagePtrs.data(), 2);
+				PRINT_ERROR("ERROR :: Batched read of a missing page. Exception should have been thrown before execution reaches this point.");
+			}
+			catch(const InvalidPageException &e)
+			{
+			}
+
+			// the buffer manager writes back and prefetches in batches
+			BufMgr* mgr = new BufMgr(num);
+			for (PageId pageNo = 1; pageNo <= num; pageNo++)
+			{
+				Page* p;
+				mgr->readPage(&file24, pageNo, p);
+				p->insertRecord("test.24 second record");
+				mgr->unPinPage(&file24, pageNo, true);
+			}
+			mgr->clearBufStats();
+			mgr->flushFile(&file24);
+			if (mgr->getBufStats().diskwrites != (int)num)
+			{
+				PRINT_ERROR("ERROR :: flushFile did not write every dirty page.");
+			}
+			mgr->prefetch(&file24, 1, num);
+			for (PageId pageNo = 1; pageNo <= num; pageNo++)
+			{
+				Page* p;
+				mgr->readPage(&file24, pageNo, p);
+				if (p->getRecord({pageNo, 2}) != "test.24 second record")
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+				mgr->unPinPage(&file24, pageNo, false);
+			}
+			delete mgr;
+		}
+		File::remove(filename);
+	}
+
+	std::cout << "Test 24 passed" << "\n";
+}
+
+/**
+ * Drops the pages of a file from the operating system's page cache.
+ */
+void dropCachedPages(const std::string& filename)
+{
+	const int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd >= 0)
+	{
+		::fdatasync(fd);
+		::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		::close(fd);
+	}
+}
+
+/**
+ * Returns how many KB of a file are in the operating system's page cache.
+ */
+long cachedKb(const std::string& filename)
+{
+	const int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return -1;
+	}
+	const off_t size = ::lseek(fd, 0, SEEK_END);
+	const long pageSize = ::sysconf(_SC_PAGESIZE);
+	long resident = -1;
+	void* region = size > 0 ? ::mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	if (region != MAP_FAILED)
+	{
+		std::vector<unsigned char> residency((size + pageSize - 1) / pageSize);
+		if (::mincore(region, size, residency.data()) == 0)
+		{
+			resident = 0;
+			for (const unsigned char r : residency)
+			{
+				resident += r & 1;
+			}
+			resident *= pageSize / 1024;
+		}
+		::munmap(region, size);
+	}
+	::close(fd);
+	return resident;
+}
+
+/**
+ * Returns the resident set size of this process in KB.
+ */
+long residentKb()
+{
+	std::ifstream statm("/proc/self/statm");
+	long size = 0, resident = -1;
+	statm >> size >> resident;
+	return resident < 0 ? -1 : resident * (::sysconf(_SC_PAGESIZE) / 1024);
+}
+
+void test25()
+{
+	// Random reads through the buffer manager from a cold file several times
+	// larger than the pool, buffered and with O_DIRECT.  Buffered reads leave
+	// a second copy of every page in the page cache; direct reads go straight
+	// into the frames.
+	const std::string& filename = "test.25";
+	const PageId numPages = 40 * num;
+	const std::size_t reads = 4 * numPages;
+	const FileBackend backends[] = {FileBackend::DESCRIPTOR, FileBackend::DIRECT};
+
+	for (const FileBackend backend : backends)
+	{
+		const char* name = backend == FileBackend::DIRECT ? "direct" : "buffered";
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+
+		try
+		{
+			File file25 = File::create(filename, backend);
+			std::vector<Page> batch(64);
+			std::vector<const Page*> batchPtrs;
+			for (PageId j = 0; j < numPages; j++)
+			{
+				Page& new_page = batch[batchPtrs.size()];
+				file25.allocatePage(new_page);
+				sprintf((char*)tmpbuf, "test.25 Page %u %7.1f", new_page.page_number(), (float)new_page.page_number());
+				new_page.insertRecord(tmpbuf);
+				batchPtrs.push_back(&new_page);
+				if (batchPtrs.size() == batch.size())
+				{
+					file25.writePages(batchPtrs.data(), batchPtrs.size());
+					batchPtrs.clear();
+				}
+			}
+			file25.writePages(batchPtrs.data(), batchPtrs.size());
+		}
+		catch(const FileIOException &e)
+		{
+			// e.g. a file system without O_DIRECT, such as tmpfs
+			std::cout << "Test 25: " << name << " files not supported here, skipped" << "\n";
+			continue;
+		}
+		dropCachedPages(filename);
+
+		{
+			File file25 = File::open(filename, backend);
+			file25.adviseAccess(AccessPattern::RANDOM);
+			BufMgr* mgr = new BufMgr(num);
+			std::minstd_rand rng(25);
+			const auto start = std::chrono::steady_clock::now();
+			for (std::size_t k = 0; k < reads; k++)
+			{
+				const PageId pageNo = 1 + rng() % numPages;
+				Page* p;
+				mgr->readPage(&file25, pageNo, p);
+				sprintf((char*)tmpbuf, "test.25 Page %u %7.1f", pageNo, (float)pageNo);
+				if (strncmp((*p->begin()).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+				// every tenth page is changed, so evictions write too
+				if (k % 10 == 0 && p->getFreeSpace() > 100)
+				{
+					p->insertRecord("test.25 update");
+				}
+				mgr->unPinPage(&file25, pageNo, k % 10 == 0);
+			}
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			std::cout << "Test 25: " << name << " backend, " << (long)(reads / elapsed.count()) << " reads/s, "
+				<< cachedKb(filename) << " KB of the " << numPages * Page::SIZE / 1024 << " KB file cached by the OS, process RSS "
+				<< residentKb() << " KB" << "\n";
+			mgr->flushFile(&file25);
+			delete mgr;
+		}
+
+		{
+			// the direct writes reach the file
+			File file25 = File::open(filename, FileBackend::STREAM);
+			PageId visited = 0;
+			for (FileIterator iter = file25.begin(); iter != file25.end(); ++iter)
+			{
+				visited++;
+			}
+			std::minstd_rand rng(25);
+			const PageId pageNo = 1 + rng() % numPages;
+			if (visited != numPages || file25.readPage(pageNo).getRecord({pageNo, 2}) != "test.25 update")
+			{
+				PRINT_ERROR("ERROR :: Changes made through the buffer manager were lost.");
+			}
+		}
+		File::remove(filename);
+	}
+
+	std::cout << "Test 25 passed" << "\n";
+}
+
+void test26()
+{
+	// Flush a pool full of dirty pages that were read in random order, so
+	// frame order and page order differ, once through flushFile() and once
+	// through the destructor.  Then flush a one page file in a pool full of
+	// another file's pages, which only visits that file's frame.
+	const std::string& filename = "test.26";
+	const std::string& smallname = "test.26s";
+	const std::uint32_t frames = 20 * num;
+	const PageId numPages = frames;
+	const std::string filenames[] = {filename, smallname};
+
+	for (const std::string& name : filenames)
+	{
+		try
+		{
+			File::remove(name);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+	}
+
+	{
+		File file26 = File::create(filename);
+		File small26 = File::create(smallname);
+		std::vector<Page> batch(64);
+		std::vector<const Page*> batchPtrs;
+		std::vector<PageId> order;
+		for (PageId j = 0; j < numPages; j++)
+		{
+			Page& new_page = batch[batchPtrs.size()];
+			file26.allocatePage(new_page);
+			order.push_back(new_page.page_number());
+			batchPtrs.push_back(&new_page);
+			if (batchPtrs.size() == batch.size())
+			{
+				file26.writePages(batchPtrs.data(), batchPtrs.size());
+				batchPtrs.clear();
+			}
+		}
+		file26.writePages(batchPtrs.data(), batchPtrs.size());
+		small26.writePage(small26.allocatePage());
+
+		std::shuffle(order.begin(), order.end(), std::minstd_rand(26));
+
+		for (int round = 0; round < 2; round++)
+		{
+			BufMgr* mgr = new BufMgr(frames);
+			for (const PageId pageNo : order)
+			{
+				Page* p;
+				mgr->readPage(&file26, pageNo, p);
+				sprintf((char*)tmpbuf, "test.26 round %d", round);
+				p->insertRecord(tmpbuf);
+				mgr->unPinPage(&file26, pageNo, true);
+			}
+			const auto start = std::chrono::steady_clock::now();
+			if (round == 0)
+			{
+				mgr->flushFile(&file26);
+				if (mgr->getBufStats().diskwrites != (int)numPages)
+				{
+					PRINT_ERROR("ERROR :: flushFile did not write every dirty page.");
+				}
+			}
+			delete mgr;
+			const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			std::cout << "Test 26: " << numPages * Page::SIZE / 1024 << " KB of dirty pages written by "
+				<< (round == 0 ? "flushFile" : "the destructor") << " in " << elapsed.count() << " ms" << "\n";
+		}
+
+		// all but one frame hold pages of the big file
+		BufMgr* mgr = new BufMgr(frames);
+		for (PageId k = 0; k + 1 < frames; k++)
+		{
+			Page* p;
+			mgr->readPage(&file26, order[k], p);
+			mgr->unPinPage(&file26, order[k], false);
+		}
+		Page* p;
+		mgr->readPage(&small26, 1, p);
+		p->insertRecord("test.26 small");
+		mgr->unPinPage(&small26, 1, true);
+		const auto start = std::chrono::steady_clock::now();
+		mgr->flushFile(&small26);
+		const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << "Test 26: flushFile of a one page file in a pool of " << frames << " frames in "
+			<< elapsed.count() << " us" << "\n";
+		delete mgr;
+	}
+
+	{
+		File file26 = File::open(filename);
+		PageId visited = 0;
+		for (FileIterator iter = file26.begin(); iter != file26.end(); ++iter)
+		{
+			const Page& page26 = *iter;
+			if (page26.getRecord({page26.page_number(), 1}) != "test.26 round 0" ||
+				page26.getRecord({page26.page_number(), 2}) != "test.26 round 1")
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			visited++;
+		}
+		if (visited != numPages || File::open(smallname).readPage(1).getRecord({1, 1}) != "test.26 small")
+		{
+			PRINT_ERROR("ERROR :: Flushed pages were lost.");
+		}
+	}
+	File::remove(filename);
+	File::remove(smallname);
+
+	std::cout << "Test 26 passed" << "\n";
+}
+
+void test27()
+{
+	// Hits on a file whose pages are all in the pool, translated through the
+	// hash table and then through a page table.  Pages allocated while the
+	// page table is enabled grow it.
+	const std::string& filename = "test.27";
+	const std::uint32_t frames = 40 * num;
+	const PageId numPages = frames / 2;
+	const std::size_t hits = 500000;
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file27 = File::create(filename);
+		BufMgr* mgr = new BufMgr(frames);
+		std::vector<PageId> pageNos;
+		for (PageId j = 0; j < numPages; j++)
+		{
+			PageId pageNo;
+			Page* p;
+			mgr->allocPage(&file27, pageNo, p);
+			sprintf((char*)tmpbuf, "test.27 Page %u %7.1f", pageNo, (float)pageNo);
+			p->insertRecord(tmpbuf);
+			mgr->unPinPage(&file27, pageNo, true);
+			pageNos.push_back(pageNo);
+		}
+
+		for (int round = 0; round < 2; round++)
+		{
+			if (round == 1 && !mgr->enablePageTable(&file27))
+			{
+				PRINT_ERROR("ERROR :: Could not enable a page table.");
+			}
+			for (const PageId pageNo : pageNos)
+			{
+				Page* p;
+				mgr->readPage(&file27, pageNo, p);
+				mgr->unPinPage(&file27, pageNo, false);
+			}
+			std::minstd_rand rng(27);
+			mgr->clearBufStats();
+			const auto start = std::chrono::steady_clock::now();
+			for (std::size_t k = 0; k < hits; k++)
+			{
+				const PageId pageNo = pageNos[rng() % numPages];
+				Page* p;
+				mgr->readPage(&file27, pageNo, p);
+				mgr->unPinPage(&file27, pageNo, false);
+			}
+			const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+			std::cout << "Test 27: " << (round == 0 ? "hash table" : "page table") << ", "
+				<< elapsed.count() / hits << " ns per readPage/unPinPage hit" << "\n";
+			if (mgr->getBufStats().diskreads != 0)
+			{
+				PRINT_ERROR("ERROR :: Hits read pages from disk.");
+			}
+		}
+
+		// the table grows with the file
+		for (PageId j = 0; j < numPages; j++)
+		{
+			PageId pageNo;
+			Page* p;
+			mgr->allocPage(&file27, pageNo, p);
+			sprintf((char*)tmpbuf, "test.27 Page %u %7.1f", pageNo, (float)pageNo);
+			p->insertRecord(tmpbuf);
+			mgr->unPinPage(&file27, pageNo, true);
+			pageNos.push_back(pageNo);
+		}
+		mgr->clearBufStats();
+		for (const PageId pageNo : pageNos)
+		{
+			Page* p;
+			mgr->readPage(&file27, pageNo, p);
+			sprintf((char*)tmpbuf, "test.27 Page %u %7.1f", pageNo, (float)pageNo);
+			if (strncmp((*p->begin()).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			mgr->unPinPage(&file27, pageNo, false);
+		}
+		if (mgr->getBufStats().diskreads != 0)
+		{
+			PRINT_ERROR("ERROR :: Allocated pages were not found in the page table.");
+		}
+
+		mgr->disposePage(&file27, pageNos.back());
+		pageNos.pop_back();
+		Page* p;
+		mgr->readPage(&file27, pageNos[0], p);
+		try
+		{
+			mgr->disablePageTable(&file27);
+			PRINT_ERROR("ERROR :: Disabled the page table of a file with a pinned page. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const PagePinnedException &e)
+		{
+		}
+		mgr->unPinPage(&file27, pageNos[0], false);
+		mgr->disablePageTable(&file27);
+		for (const PageId pageNo : pageNos)
+		{
+			mgr->readPage(&file27, pageNo, p);
+			sprintf((char*)tmpbuf, "test.27 Page %u %7.1f", pageNo, (float)pageNo);
+			if (strncmp((*p->begin()).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			mgr->unPinPage(&file27, pageNo, false);
+		}
+		delete mgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 27 passed" << "\n";
+}
+
+void test28()
+{
+	// Grow a full pool and check the cached pages stay, then shrink it with a
+	// page pinned past the new end, which must fail, and without.
+	const std::string& filename = "test.28";
+	const ReplacementPolicyType policies[] = {ReplacementPolicyType::CLOCK, ReplacementPolicyType::LRU_K,
+		ReplacementPolicyType::TWO_Q, ReplacementPolicyType::ARC};
+
+	for (const ReplacementPolicyType policy : policies)
+	{
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+
+		{
+			File file28 = File::create(filename);
+			BufMgr* mgr = new BufMgr(num, policy);
+			for (PageId j = 0; j < 3 * num; j++)
+			{
+				PageId pageNo;
+				Page* p;
+				mgr->allocPage(&file28, pageNo, p);
+				sprintf((char*)tmpbuf, "test.28 Page %u %7.1f", pageNo, (float)pageNo);
+				p->insertRecord(tmpbuf);
+				mgr->unPinPage(&file28, pageNo, true);
+			}
+			mgr->flushFile(&file28);
+
+			Page* p;
+			for (PageId pageNo = 1; pageNo <= num; pageNo++)
+			{
+				mgr->readPage(&file28, pageNo, p);
+				mgr->unPinPage(&file28, pageNo, false);
+			}
+			if (!mgr->resize(2 * num) || mgr->poolSize() != 2 * num)
+			{
+				PRINT_ERROR("ERROR :: Pool did not grow.");
+			}
+			for (PageId pageNo = num + 1; pageNo <= 2 * num; pageNo++)
+			{
+				mgr->readPage(&file28, pageNo, p);
+				p->insertRecord("test.28 second record");
+				mgr->unPinPage(&file28, pageNo, true);
+			}
+			mgr->clearBufStats();
+			for (PageId pageNo = 1; pageNo <= 2 * num; pageNo++)
+			{
+				mgr->readPage(&file28, pageNo, p);
+				mgr->unPinPage(&file28, pageNo, false);
+			}
+			if (mgr->getBufStats().diskreads != 0)
+			{
+				PRINT_ERROR("ERROR :: Growing the pool dropped cached pages.");
+			}
+
+			// every frame from num / 2 on holds a page; pin one of them
+			mgr->readPage(&file28, 2 * num, p);
+			if (mgr->resize(num / 2) || mgr->poolSize() != 2 * num)
+			{
+				PRINT_ERROR("ERROR :: Pool shrank past a pinned page.");
+			}
+			sprintf((char*)tmpbuf, "test.28 Page %u %7.1f", 2 * num, (float)(2 * num));
+			if (strncmp((*p->begin()).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			mgr->unPinPage(&file28, 2 * num, false);
+			mgr->clearBufStats();
+			for (PageId pageNo = 1; pageNo <= 2 * num; pageNo++)
+			{
+				mgr->readPage(&file28, pageNo, p);
+				mgr->unPinPage(&file28, pageNo, false);
+			}
+			if (mgr->getBufStats().diskreads != 0)
+			{
+				PRINT_ERROR("ERROR :: A failed shrink dropped cached pages.");
+			}
+
+			if (!mgr->resize(num / 2) || mgr->poolSize() != num / 2)
+			{
+				PRINT_ERROR("ERROR :: Pool did not shrink.");
+			}
+			std::vector<PageId> pinned;
+			try
+			{
+				for (PageId pageNo = 1; pageNo <= num; pageNo++)
+				{
+					mgr->readPage(&file28, pageNo, p);
+					pinned.push_back(pageNo);
+				}
+				PRINT_ERROR("ERROR :: Pinned more pages than the shrunk pool has frames. Exception should have been thrown before execution reaches this point.");
+			}
+			catch(const BufferExceededException &e)
+			{
+			}
+			if (pinned.size() != num / 2)
+			{
+				PRINT_ERROR("ERROR :: Shrunk pool did not use all of its frames.");
+			}
+			for (const PageId pageNo : pinned)
+			{
+				mgr->unPinPage(&file28, pageNo, false);
+			}
+
+			// a memory limit of about a third of the pages
+			if (!mgr->setMemoryLimit(num * Page::SIZE / 3) || mgr->poolSize() == 0 || mgr->poolSize() >= num / 3)
+			{
+				PRINT_ERROR("ERROR :: Memory limit did not resize the pool.");
+			}
+			for (PageId pageNo = 1; pageNo <= 3 * num; pageNo++)
+			{
+				mgr->readPage(&file28, pageNo, p);
+				sprintf((char*)tmpbuf, "test.28 Page %u %7.1f", pageNo, (float)pageNo);
+				if (strncmp((*p->begin()).c_str(), tmpbuf, strlen(tmpbuf)) != 0 ||
+					(pageNo > num && pageNo <= 2 * num && p->getRecord({pageNo, 2}) != "test.28 second record"))
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+				mgr->unPinPage(&file28, pageNo, false);
+			}
+			if (mgr->resize(0))
+			{
+				PRINT_ERROR("ERROR :: Resized the pool to no frames.");
+			}
+			// without a maximum the pool may grow to four times its initial size
+			if (mgr->resize(4 * num + 1) || !mgr->resize(4 * num) || mgr->poolSize() != 4 * num)
+			{
+				PRINT_ERROR("ERROR :: Pool did not grow to exactly its default maximum.");
+			}
+			delete mgr;
+
+			mgr = new BufMgr(num, policy, false, 2 * num);
+			if (mgr->resize(2 * num + 1) || !mgr->resize(2 * num) || mgr->poolSize() != 2 * num)
+			{
+				PRINT_ERROR("ERROR :: Pool did not grow to exactly the given maximum.");
+			}
+			delete mgr;
+		}
+		File::remove(filename);
+	}
+
+	std::cout << "Test 28 passed" << "\n";
+}
+
+void test29()
+{
+	// Pages are returned by value from File::readPage(), File::allocatePage()
+	// and FileIterator, and copied and moved like any value.  Their bytes are
+	// stored inline, so none of this touches the heap.
+	const std::string& filename = "test.29";
+	const PageId numPages = 20 * num;
+	const std::size_t reads = 20 * numPages;
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file29 = File::create(filename);
+		CountAllocations counting;
+		std::size_t before = heapAllocations;
+		std::vector<PageId> pageNos;
+		auto start = std::chrono::steady_clock::now();
+		for (PageId j = 0; j < numPages; j++)
+		{
+			Page new_page = file29.allocatePage();
+			new_page.insertRecord("test.29");
+			file29.writePage(new_page);
+			pageNos.push_back(new_page.page_number());
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		// the record strings and the vector allocate, the pages don't
+		std::cout << "Test 29: allocatePage/writePage, " << (long)(numPages / elapsed.count()) << " pages/s, "
+			<< heapAllocations - before << " heap allocations for " << numPages << " pages" << "\n";
+
+		std::minstd_rand rng(29);
+		PageId checked = 0;
+		before = heapAllocations;
+		start = std::chrono::steady_clock::now();
+		for (std::size_t k = 0; k < reads; k++)
+		{
+			const PageId pageNo = pageNos[rng() % numPages];
+			Page p = file29.readPage(pageNo);
+			Page copy = p;
+			Page moved = std::move(copy);
+			checked += moved.page_number() == pageNo;
+		}
+		elapsed = std::chrono::steady_clock::now() - start;
+		const std::size_t readAllocations = heapAllocations - before;
+		std::cout << "Test 29: readPage by value plus a copy and a move, " << (long)(reads / elapsed.count()) << " pages/s, "
+			<< readAllocations << " heap allocations for " << reads << " pages" << "\n";
+
+		before = heapAllocations;
+		start = std::chrono::steady_clock::now();
+		PageId visited = 0;
+		for (int round = 0; round < 20; round++)
+		{
+			for (FileIterator iter = file29.begin(); iter != file29.end(); ++iter)
+			{
+				const Page p = *iter;
+				visited += p.getFreeSpace() > 0;
+			}
+		}
+		elapsed = std::chrono::steady_clock::now() - start;
+		const std::size_t scanAllocations = heapAllocations - before;
+		std::cout << "Test 29: FileIterator scan, " << (long)(visited / elapsed.count()) << " pages/s, "
+			<< scanAllocations << " heap allocations for " << visited << " pages" << "\n";
+
+		if (checked != reads || visited != 20 * numPages)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		if (readAllocations != 0 || scanAllocations != 0)
+		{
+			PRINT_ERROR("ERROR :: Passing pages around allocated memory.");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 29 passed" << "\n";
+}
+
+void test30()
+{
+	// Scans the records of pinned pages, once copying every record into a
+	// string and once through views into the frames.  Records are inserted
+	// from raw bytes and are too long for the short string optimization.
+	const std::string& filename = "test.30";
+	const PageId numPages = num;
+	const int rounds = 20;
+	const std::size_t recordLength = 48;
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file30 = File::create(filename);
+		BufMgr* mgr = new BufMgr(numPages);
+		std::vector<PageId> pageNos;
+		std::vector<Page*> pages;
+		char record[recordLength];
+		std::size_t numRecords = 0;
+		for (PageId j = 0; j < numPages; j++)
+		{
+			PageId pageNo;
+			Page* p;
+			mgr->allocPage(&file30, pageNo, p);
+			while (p->hasSpaceForRecord(recordLength))
+			{
+				std::memset(record, 'a' + numRecords % 26, recordLength);
+				p->insertRecord(record, recordLength);
+				numRecords++;
+			}
+			pageNos.push_back(pageNo);
+			pages.push_back(p);
+		}
+
+		std::size_t copied = 0;
+		CountAllocations counting;
+		std::size_t before = heapAllocations;
+		auto start = std::chrono::steady_clock::now();
+		for (int round = 0; round < rounds; round++)
+		{
+			for (Page* p : pages)
+			{
+				for (PageIterator iter = p->begin(); iter != p->end(); ++iter)
+				{
+					const std::string r = *iter;
+					copied += r.length() + (r[0] == 'a');
+				}
+			}
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		const std::size_t copyAllocations = heapAllocations - before;
+		std::cout << "Test 30: copying scan, " << (long)(rounds * numRecords / elapsed.count()) << " records/s, "
+			<< copyAllocations << " heap allocations" << "\n";
+
+		std::size_t viewed = 0;
+		std::size_t outside = 0;
+		before = heapAllocations;
+		start = std::chrono::steady_clock::now();
+		for (int round = 0; round < rounds; round++)
+		{
+			for (Page* p : pages)
+			{
+				const char* frame = reinterpret_cast<const char*>(p);
+				for (PageIterator iter = p->begin(); iter != p->end(); ++iter)
+				{
+					const RecordView r = iter.view();
+					viewed += r.length + (r.data[0] == 'a');
+					outside += r.data < frame || r.data + r.length > frame + Page::SIZE;
+				}
+			}
+		}
+		elapsed = std::chrono::steady_clock::now() - start;
+		const std::size_t viewAllocations = heapAllocations - before;
+		std::cout << "Test 30: view scan, " << (long)(rounds * numRecords / elapsed.count()) << " records/s, "
+			<< viewAllocations << " heap allocations" << "\n";
+
+		if (copied != viewed || viewAllocations != 0)
+		{
+			PRINT_ERROR("ERROR :: View scan did not match copying scan.");
+		}
+		// views point into the frames rather than at copies, and the copies
+		// are what the view scan saves
+		if (outside != 0)
+		{
+			PRINT_ERROR("ERROR :: Record view does not point into its frame.");
+		}
+		if (copyAllocations < rounds * numRecords)
+		{
+			PRINT_ERROR("ERROR :: Copying scan did not allocate a string per record.");
+		}
+
+		// a record can be updated from a view of another record on its page,
+		// even though deleting the old version moves that record
+		Page* p = pages[0];
+		PageIterator first = p->begin();
+		PageIterator second = first;
+		++second;
+		const std::string expected = *second;
+		const RecordView source = second.view();
+		p->updateRecord(first.record_id(), source.data, source.length);
+		if (p->viewRecord(first.record_id()) != expected || p->viewRecord(second.record_id()) != expected)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+
+		for (const PageId pageNo : pageNos)
+		{
+			mgr->unPinPage(&file30, pageNo, true);
+		}
+		delete mgr;
+	}
+	File::remove(filename);
+
+	std::cout << "Test 30 passed" << "\n";
+}
+
+void test31()
+{
+	// Delete-heavy churn on one page: a random record is deleted and records
+	// of random length are inserted while they fit.  Deletes only mark their
+	// space free; records move when an insert needs the space.  A second,
+	// untimed run of the same operations checks the contents and counts the
+	// bytes moved, and the bytes deleting would have moved by closing each
+	// gap right away.
+	const std::string& filename = "test.31";
+	const std::size_t ops = 400000;
+	const std::size_t checkedOps = 20000;
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file31 = File::create(filename);
+		char record[80];
+		for (int run = 0; run < 2; run++)
+		{
+			const bool check = run == 1;
+			Page p = file31.allocatePage();
+			std::vector<RecordId> rids;
+			std::vector<std::string> contents;
+			std::minstd_rand rng(31);
+			std::size_t done = 0;
+			std::size_t moved = 0;
+			std::size_t eagerMoved = 0;
+			const auto start = std::chrono::steady_clock::now();
+			while (done < (check ? checkedOps : ops))
+			{
+				const std::size_t length = 20 + rng() % 60;
+				if (!rids.empty() && (rids.size() > 60 || !p.hasSpaceForRecord(length)))
+				{
+					const std::size_t k = rng() % rids.size();
+					std::vector<const char*> before;
+					if (check)
+					{
+						const char* gap = p.viewRecord(rids[k]).data;
+						for (const RecordId& rid : rids)
+						{
+							const RecordView r = p.viewRecord(rid);
+							eagerMoved += r.data < gap ? r.length : 0;
+							before.push_back(r.data);
+						}
+					}
+					p.deleteRecord(rids[k]);
+					for (std::size_t j = 0; j < before.size(); j++)
+					{
+						if (j != k && p.viewRecord(rids[j]).data != before[j])
+						{
+							PRINT_ERROR("ERROR :: Delete moved another record.");
+						}
+					}
+					rids[k] = rids.back();
+					rids.pop_back();
+					contents[k] = contents.back();
+					contents.pop_back();
+				}
+				else
+				{
+					std::memset(record, 'a' + done % 26, length);
+					std::vector<const char*> before;
+					if (check)
+					{
+						for (const RecordId& rid : rids)
+						{
+							before.push_back(p.viewRecord(rid).data);
+						}
+					}
+					rids.push_back(p.insertRecord(record, length));
+					if (check)
+					{
+						contents.push_back(std::string(record, length));
+						for (std::size_t k = 0; k < before.size(); k++)
+						{
+							const RecordView r = p.viewRecord(rids[k]);
+							moved += r.data != before[k] ? r.length : 0;
+						}
+					}
+					else
+					{
+						contents.push_back(std::string());
+					}
+				}
+				done++;
+			}
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			if (!check)
+			{
+				std::cout << "Test 31: churn, " << (long)(done / elapsed.count()) << " deletes and inserts/s" << "\n";
+				continue;
+			}
+			std::cout << "Test 31: " << moved << " bytes moved over " << done << " deletes and inserts, "
+				<< eagerMoved << " bytes when closing every gap on delete" << "\n";
+			for (std::size_t k = 0; k < rids.size(); k++)
+			{
+				if (p.viewRecord(rids[k]) != contents[k])
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+			}
+			// compacting once when space runs out moves a small fraction of
+			// what closing every gap would
+			if (4 * moved > eagerMoved)
+			{
+				PRINT_ERROR("ERROR :: Compaction moved over a quarter of the bytes closing every gap would.");
+			}
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 31 passed" << "\n";
+}
+
+void test32()
+{
+	// Counter updates on a full page of records.  Every round rewrites all
+	// records at the same size, then shrinks them and then grows them back.
+	const std::string& filename = "test.32";
+	const int rounds = 1000;
+	const char* const phases[] = {"same size", "shrink", "grow"};
+	const std::size_t lengths[] = {24, 16, 24};
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file32 = File::create(filename);
+		Page p = file32.allocatePage();
+		std::vector<RecordId> rids;
+		char record[32];
+		std::memset(record, '0', sizeof(record));
+		while (p.hasSpaceForRecord(lengths[0]))
+		{
+			rids.push_back(p.insertRecord(record, lengths[0]));
+		}
+
+		std::uint32_t counter = 0;
+		std::chrono::duration<double> elapsed[3] = {};
+		for (int round = 0; round < rounds; round++)
+		{
+			for (int phase = 0; phase < 3; phase++)
+			{
+				const std::size_t length = lengths[phase];
+				std::vector<const char*> before;
+				for (const RecordId& rid : rids)
+				{
+					before.push_back(p.viewRecord(rid).data);
+				}
+				const std::size_t freeBefore = p.getFreeSpace();
+				const auto start = std::chrono::steady_clock::now();
+				for (const RecordId& rid : rids)
+				{
+					sprintf(record, "%0*u", (int)length, ++counter);
+					p.updateRecord(rid, record, length);
+				}
+				elapsed[phase] += std::chrono::steady_clock::now() - start;
+				// updates that fit the old extent are made in place, and every
+				// update only changes the free space by its change in length
+				for (std::size_t k = 0; phase < 2 && k < rids.size(); k++)
+				{
+					if (p.viewRecord(rids[k]).data != before[k])
+					{
+						PRINT_ERROR("ERROR :: Update that fits its record was not made in place.");
+					}
+				}
+				const std::size_t oldLength = lengths[(phase + 2) % 3];
+				if (p.getFreeSpace() + rids.size() * length != freeBefore + rids.size() * oldLength)
+				{
+					PRINT_ERROR("ERROR :: Updates did not account their space exactly.");
+				}
+				std::size_t used = 0;
+				for (PageIterator iter = p.begin(); iter != p.end(); ++iter)
+				{
+					used++;
+				}
+				if (used != rids.size())
+				{
+					PRINT_ERROR("ERROR :: Updates changed the number of used slots.");
+				}
+
+				std::uint32_t expected = counter - rids.size();
+				for (const RecordId& rid : rids)
+				{
+					sprintf(record, "%0*u", (int)length, ++expected);
+					if (p.viewRecord(rid) != std::string(record, length))
+					{
+						PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+					}
+				}
+			}
+		}
+		for (int phase = 0; phase < 3; phase++)
+		{
+			std::cout << "Test 32: " << phases[phase] << " updates, "
+				<< (long)(rounds * rids.size() / elapsed[phase].count()) << " updates/s" << "\n";
+		}
+
+		// the lowest record on a page grows into the free space below it
+		// without moving the records above
+		Page q = file32.allocatePage();
+		const RecordId upper = q.insertRecord("upper record");
+		const RecordId lower = q.insertRecord("lower");
+		const char* upperData = q.viewRecord(upper).data;
+		const char* lowerData = q.viewRecord(lower).data;
+		const std::size_t freeBefore = q.getFreeSpace();
+		q.updateRecord(lower, "lower record, grown");
+		if (q.viewRecord(upper).data != upperData || q.viewRecord(lower).data != lowerData - 14 ||
+			q.getFreeSpace() != freeBefore - 14 || q.viewRecord(lower) != "lower record, grown")
+		{
+			PRINT_ERROR("ERROR :: Lowest record did not grow in place.");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 32 passed" << "\n";
+}
+
+void test33()
+{
+	// Pages of one-byte records.  Every round fills a page, deletes seven of
+	// every eight records, iterates over the rest and fills the freed slots
+	// again, which reuses them lowest first.
+	const std::string& filename = "test.33";
+	const int rounds = 1000;
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file33 = File::create(filename);
+		std::size_t inserted = 0;
+		std::size_t reinserted = 0;
+		std::size_t iterated = 0;
+		std::chrono::duration<double> insertTime(0);
+		std::chrono::duration<double> reinsertTime(0);
+		std::chrono::duration<double> iterateTime(0);
+		for (int round = 0; round < rounds; round++)
+		{
+			Page p = file33.allocatePage();
+			std::vector<RecordId> rids;
+			auto start = std::chrono::steady_clock::now();
+			while (p.hasSpaceForRecord(1))
+			{
+				const char c = 'a' + rids.size() % 26;
+				rids.push_back(p.insertRecord(&c, 1));
+			}
+			insertTime += std::chrono::steady_clock::now() - start;
+			inserted += rids.size();
+			// one-byte records fill every slot the bitmap can track
+			if (rids.size() != Page::MAX_SLOTS)
+			{
+				PRINT_ERROR("ERROR :: Page did not fill all of its slots.");
+			}
+
+			for (std::size_t k = 0; k < rids.size(); k++)
+			{
+				if (k % 8 != 0)
+				{
+					p.deleteRecord(rids[k]);
+				}
+			}
+
+			std::size_t found = 0;
+			start = std::chrono::steady_clock::now();
+			for (PageIterator iter = p.begin(); iter != p.end(); ++iter)
+			{
+				found += iter.view().data[0] == 'a' + (iter.record_id().slot_number - 1) % 26;
+			}
+			iterateTime += std::chrono::steady_clock::now() - start;
+			iterated += (rids.size() + 7) / 8;
+
+			start = std::chrono::steady_clock::now();
+			std::size_t refilled = 0;
+			SlotId expected = 2;
+			while (p.hasSpaceForRecord(1))
+			{
+				const char c = 'z';
+				const RecordId rid = p.insertRecord(&c, 1);
+				if (rid.slot_number != expected)
+				{
+					PRINT_ERROR("ERROR :: Freed slots were not reused lowest first.");
+				}
+				expected += expected % 8 == 0 ? 2 : 1;
+				refilled++;
+			}
+			reinsertTime += std::chrono::steady_clock::now() - start;
+			reinserted += refilled;
+			if (found != (rids.size() + 7) / 8 || refilled != rids.size() - found)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+		std::cout << "Test 33: " << inserted / rounds << " records per page, "
+			<< (long)(inserted / insertTime.count()) << " inserts/s into new slots, "
+			<< (long)(reinserted / reinsertTime.count()) << " inserts/s into freed slots, "
+			<< (long)(iterated / iterateTime.count()) << " records/s iterating over 1 in 8 used slots" << "\n";
+	}
+	File::remove(filename);
+
+	std::cout << "Test 33 passed" << "\n";
+}
+
+void test34()
+{
+	// Records per page and scan throughput for small records.
+	const std::string& filename = "test.34";
+	const PageId numPages = 5 * num;
+	const int rounds = 20;
+	const std::size_t lengths[] = {16, 32, 64};
+
+	for (const std::size_t length : lengths)
+	{
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+
+		{
+			File file34 = File::create(filename);
+			char record[64];
+			std::memset(record, 'r', sizeof(record));
+			std::size_t perPage = 0;
+			for (PageId j = 0; j < numPages; j++)
+			{
+				Page p = file34.allocatePage();
+				perPage = 0;
+				while (p.hasSpaceForRecord(length))
+				{
+					p.insertRecord(record, length);
+					perPage++;
+				}
+				file34.writePage(p);
+			}
+
+			std::size_t scanned = 0;
+			std::size_t bytes = 0;
+			const auto start = std::chrono::steady_clock::now();
+			for (int round = 0; round < rounds; round++)
+			{
+				for (FileIterator iter = file34.begin(); iter != file34.end(); ++iter)
+				{
+					const Page p = *iter;
+					for (PageIterator page_iter = p.begin(); page_iter != p.end(); ++page_iter)
+					{
+						bytes += page_iter.view().length;
+						scanned++;
+					}
+				}
+			}
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			std::cout << "Test 34: " << length << "-byte records, " << perPage << " records per page, "
+				<< (long)(scanned / elapsed.count()) << " records/s scanned" << "\n";
+			if (scanned != rounds * numPages * perPage || bytes != scanned * length)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			// every record costs its bytes plus a 4-byte slot, and nothing else
+			if (perPage != Page::DATA_SIZE / (length + sizeof(PageSlot)))
+			{
+				PRINT_ERROR("ERROR :: Page did not hold as many records as its slot layout allows.");
+			}
+		}
+		File::remove(filename);
+	}
+
+	std::cout << "Test 34 passed" << "\n";
+}
+
+void test35()
+{
+	// Opens a file written by hand in format version 2, with 6-byte slots and
+	// no used-slot bitmap, and checks that it is converted and that records
+	// keep their IDs.
+	const std::string& filename = "test.35";
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	const char* const records[] = {"first", "", "third record", "fourth"};
+	{
+		// header page, one data page with a deleted second slot, one free page
+		std::vector<char> bytes(3 * Page::SIZE, 0);
+		const FileHeader header = {File::MAGIC, 2, 3, 1, 0};
+		std::memcpy(&bytes[0], &header, sizeof(header));
+		bytes[File::MAP_OFFSET] = 0x03;
+
+		char* page = &bytes[Page::SIZE];
+		char* data = page + 16;
+		std::uint16_t upper = Page::SIZE - 16;
+		for (int i = 0; i < 4; i++)
+		{
+			const std::uint16_t length = i == 1 ? 0 : std::strlen(records[i]);
+			upper -= length;
+			std::memcpy(data + upper, records[i], length);
+			char* slot = data + 6 * i;
+			slot[0] = i != 1;
+			const std::uint16_t offset = i == 1 ? 0 : upper;
+			std::memcpy(slot + 2, &offset, 2);
+			std::memcpy(slot + 4, &length, 2);
+		}
+		const std::uint16_t fields[] = {4 * 6, upper, 4, 1};
+		const PageId pageNo = 1;
+		std::memcpy(page, fields, sizeof(fields));
+		std::memcpy(page + 8, &pageNo, sizeof(pageNo));
+
+		std::ofstream out(filename, std::ios::binary);
+		out.write(&bytes[0], bytes.size());
+	}
+
+	try
+	{
+		File::open(filename, FileBackend::MMAP_READ_ONLY);
+		PRINT_ERROR("ERROR :: Opened a file of an old format version read-only.");
+	}
+	catch(const InvalidFileFormatException &e)
+	{
+	}
+
+	// opening it converts it, and converting it again does nothing
+	{
+		File file35 = File::open(filename);
+	}
+	File::convert(filename);
+	{
+		File file35 = File::open(filename);
+		const Page p = file35.readPage(1);
+		std::vector<std::string> found;
+		for (PageIterator iter = p.begin(); iter != p.end(); ++iter)
+		{
+			found.push_back(*iter);
+		}
+		if (found.size() != 3 || p.getRecord({1, 1}) != records[0] || p.getRecord({1, 3}) != records[2] ||
+			p.getRecord({1, 4}) != records[3])
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+
+		// the deleted slot is reused, and the free page too
+		Page q = file35.readPage(1);
+		if (q.insertRecord("second").slot_number != 2 || file35.allocatePage().page_number() != 2)
+		{
+			PRINT_ERROR("ERROR :: Converted file did not reuse free space.");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 35 passed" << "\n";
+}
+
+void test36()
+{
+	// Hit and miss latency of the hash table, looked up the way BufMgr did
+	// before tryLookup existed (catching HashNotFoundException on a miss) and
+	// the way it does now.  Both must agree, and tryLookup must report a miss
+	// by returning false rather than by throwing.
+	const std::string& filename = "test.36";
+	const PageId numPages = num;
+	const int rounds = 1000;
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file36 = File::create(filename);
+		BufHashTbl table(numPages);
+		for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+		{
+			table.insert(&file36, pageNo, pageNo - 1);
+		}
+
+		// pages 1..numPages hit, numPages+1..2*numPages miss
+		double micros[2][2];
+		for (int hit = 0; hit < 2; hit++)
+		{
+			const PageId first = hit ? 1 : numPages + 1;
+			for (int useTry = 0; useTry < 2; useTry++)
+			{
+				std::size_t found = 0;
+				const auto start = std::chrono::steady_clock::now();
+				for (int round = 0; round < rounds; round++)
+				{
+					for (PageId pageNo = first; pageNo < first + numPages; pageNo++)
+					{
+						FrameId frameNo = numPages;
+						if (useTry)
+						{
+							try
+							{
+								if (table.tryLookup(&file36, pageNo, frameNo))
+								{
+									found++;
+								}
+							}
+							catch(const HashNotFoundException &e)
+							{
+								PRINT_ERROR("ERROR :: tryLookup threw on a miss.");
+							}
+						}
+						else
+						{
+							try
+							{
+								table.lookup(&file36, pageNo, frameNo);
+								found++;
+							}
+							catch(const HashNotFoundException &e)
+							{
+							}
+						}
+						if (frameNo != (hit ? pageNo - 1 : numPages))
+						{
+							PRINT_ERROR("ERROR :: Lookup returned the wrong frame.");
+						}
+					}
+				}
+				const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+				micros[hit][useTry] = elapsed.count();
+				if (found != (hit ? (std::size_t)rounds * numPages : 0))
+				{
+					PRINT_ERROR("ERROR :: Lookup found the wrong number of pages.");
+				}
+			}
+			std::cout << "Test 36: " << (hit ? "hit" : "miss") << " latency "
+				<< 1000 * micros[hit][0] / (rounds * numPages) << " ns with lookup, "
+				<< 1000 * micros[hit][1] / (rounds * numPages) << " ns with tryLookup" << "\n";
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 36 passed" << "\n";
+}
+
+void test37()
+{
+	// BufHashTbl on its own: a table sized for one frame has to grow many
+	// times, duplicates are refused without changing the entry, and entries
+	// stay reachable while backward-shift deletion moves their neighbours.
+	const std::string& filename1 = "test.37a";
+	const std::string& filename2 = "test.37b";
+	const PageId numPages = 40 * num;
+
+	for (const std::string& filename : {filename1, filename2})
+	{
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+	}
+
+	{
+		File file37a = File::create(filename1);
+		File file37b = File::create(filename2);
+		const File* const files[] = {&file37a, &file37b};
+		BufHashTbl table(1);
+
+		// the same page numbers in two files, so keys differ only by file
+		for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+		{
+			for (int f = 0; f < 2; f++)
+			{
+				if (!table.tryInsert(files[f], pageNo, 2 * pageNo + f))
+				{
+					PRINT_ERROR("ERROR :: Insert of a new entry was refused.");
+				}
+			}
+		}
+		for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+		{
+			for (int f = 0; f < 2; f++)
+			{
+				FrameId frameNo;
+				if (!table.tryLookup(files[f], pageNo, frameNo) || frameNo != 2 * pageNo + f)
+				{
+					PRINT_ERROR("ERROR :: Entry lost while the table grew.");
+				}
+			}
+		}
+
+		// duplicates
+		FrameId frameNo;
+		if (table.tryInsert(&file37a, 7, 0))
+		{
+			PRINT_ERROR("ERROR :: Duplicate entry was inserted.");
+		}
+		try
+		{
+			table.insert(&file37a, 7, 1);
+			PRINT_ERROR("ERROR :: Duplicate entry was inserted. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const HashAlreadyPresentException &e)
+		{
+		}
+		table.lookup(&file37a, 7, frameNo);
+		if (frameNo != 14)
+		{
+			PRINT_ERROR("ERROR :: Refused duplicate changed the entry.");
+		}
+
+		// remove a random half of the entries
+		std::minstd_rand rng(37);
+		std::vector<bool> removed(2 * (numPages + 1), false);
+		for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+		{
+			for (int f = 0; f < 2; f++)
+			{
+				if (rng() % 2)
+				{
+					table.remove(files[f], pageNo);
+					removed[2 * pageNo + f] = true;
+				}
+			}
+		}
+		for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+		{
+			for (int f = 0; f < 2; f++)
+			{
+				const bool found = table.tryLookup(files[f], pageNo, frameNo);
+				if (found == removed[2 * pageNo + f] || (found && frameNo != 2 * pageNo + f))
+				{
+					PRINT_ERROR("ERROR :: Remove lost or kept the wrong entries.");
+				}
+				if (removed[2 * pageNo + f] && table.tryRemove(files[f], pageNo))
+				{
+					PRINT_ERROR("ERROR :: Removed an entry twice.");
+				}
+			}
+		}
+		try
+		{
+			table.remove(&file37b, numPages + 1);
+			PRINT_ERROR("ERROR :: Removed a missing entry. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const HashNotFoundException &e)
+		{
+		}
+
+		// removed entries can come back with new frames
+		for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+		{
+			for (int f = 0; f < 2; f++)
+			{
+				if (removed[2 * pageNo + f])
+				{
+					table.insert(files[f], pageNo, pageNo);
+				}
+			}
+		}
+		for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+		{
+			for (int f = 0; f < 2; f++)
+			{
+				table.lookup(files[f], pageNo, frameNo);
+				if (frameNo != (removed[2 * pageNo + f] ? pageNo : 2 * pageNo + f))
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+			}
+		}
+	}
+	File::remove(filename1);
+	File::remove(filename2);
+
+	std::cout << "Test 37 passed" << "\n";
+}
+
+/**
+ * Inserts, looks up and removes pages in table the way test 38 measures,
+ * returning the time each phase took in microseconds.
+ */
+template<class Table>
+void timeHashTable(Table& table, const File* file, const std::vector<PageId>& pageNos,
+	const int lookupRounds, double micros[3])
+{
+	const FrameId numFrames = pageNos.size();
+
+	auto start = std::chrono::steady_clock::now();
+	for (FrameId frameNo = 0; frameNo < numFrames; frameNo++)
+	{
+		if (!table.tryInsert(file, pageNos[frameNo], frameNo))
+		{
+			PRINT_ERROR("ERROR :: Insert of a new entry was refused.");
+		}
+	}
+	std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+	micros[0] = elapsed.count();
+
+	start = std::chrono::steady_clock::now();
+	for (int round = 0; round < lookupRounds; round++)
+	{
+		for (FrameId frameNo = 0; frameNo < numFrames; frameNo++)
+		{
+			FrameId found;
+			if (!table.tryLookup(file, pageNos[frameNo], found) || found != frameNo)
+			{
+				PRINT_ERROR("ERROR :: Lookup returned the wrong frame.");
+			}
+		}
+	}
+	elapsed = std::chrono::steady_clock::now() - start;
+	micros[1] = elapsed.count() / lookupRounds;
+
+	start = std::chrono::steady_clock::now();
+	for (FrameId frameNo = 0; frameNo < numFrames; frameNo++)
+	{
+		if (!table.tryRemove(file, pageNos[frameNo]))
+		{
+			PRINT_ERROR("ERROR :: Entry to remove was not found.");
+		}
+	}
+	elapsed = std::chrono::steady_clock::now() - start;
+	micros[2] = elapsed.count();
+}
+
+void test38()
+{
+	// Insert, lookup and remove of a pool's worth of sequential and random
+	// page numbers, in the chained table BufHashTbl used to be and in the
+	// Robin Hood table it is now.  Both are sized the way BufMgr sizes them.
+	const std::string& filename = "test.38";
+	const FrameId numFrames = 100 * num;
+	const int lookupRounds = 20;
+	const char* const opNames[] = {"insert", "lookup", "remove"};
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file38 = File::create(filename);
+
+		std::vector<PageId> sequential(numFrames);
+		for (FrameId j = 0; j < numFrames; j++)
+		{
+			sequential[j] = 1 + j;
+		}
+		// distinct page numbers spread over a file sixteen times the pool
+		std::vector<PageId> random(16 * numFrames);
+		for (std::size_t j = 0; j < random.size(); j++)
+		{
+			random[j] = 1 + j;
+		}
+		std::shuffle(random.begin(), random.end(), std::minstd_rand(38));
+		random.resize(numFrames);
+
+		for (const std::vector<PageId>* pageNos : {&sequential, &random})
+		{
+			double chainedMicros[3];
+			double robinHoodMicros[3];
+			{
+				ChainedHashTbl chained(((((int) (numFrames * 1.2))*2)/2)+1);
+				timeHashTable(chained, &file38, *pageNos, lookupRounds, chainedMicros);
+			}
+			{
+				BufHashTbl robinHood(numFrames);
+				timeHashTable(robinHood, &file38, *pageNos, lookupRounds, robinHoodMicros);
+			}
+			for (int op = 0; op < 3; op++)
+			{
+				std::cout << "Test 38: " << (pageNos == &sequential ? "sequential" : "random") << " "
+					<< opNames[op] << " " << 1000 * chainedMicros[op] / numFrames << " ns chained, "
+					<< 1000 * robinHoodMicros[op] / numFrames << " ns Robin Hood" << "\n";
+			}
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 38 passed" << "\n";
+}
+
+void test39()
+{
+	// Threads allocating, writing and deleting pages of one file at the same
+	// time, while another keeps flushing the metadata.  Page writes run
+	// outside the metadata latch, so every thread must still get pages of
+	// its own, and the file must read back intact once reopened.
+	const std::string& filename = "test.39";
+	const FileBackend backends[] = {FileBackend::DESCRIPTOR, FileBackend::MMAP};
+	const unsigned numThreads = 4;
+	const PageId pagesPerThread = 5 * num;
+
+	for (const FileBackend backend : backends)
+	{
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+
+		std::vector<std::vector<PageId> > owned(numThreads);
+		{
+			File file39 = File::create(filename, backend);
+			std::atomic<bool> done(false);
+			std::thread flusher([&]()
+			{
+				while (!done)
+				{
+					file39.flushMetadata();
+				}
+			});
+			std::vector<std::thread> writers;
+			for (unsigned t = 0; t < numThreads; t++)
+			{
+				writers.push_back(std::thread([&, t]()
+				{
+					char record[100];
+					for (PageId j = 0; j < pagesPerThread; j++)
+					{
+						Page p = file39.allocatePage();
+						sprintf(record, "test.39 thread %u page %u", t, p.page_number());
+						p.insertRecord(record);
+						file39.writePage(p);
+						owned[t].push_back(p.page_number());
+						// give every fourth page back so others reuse it
+						if (j % 4 == 3)
+						{
+							file39.deletePage(owned[t].front());
+							owned[t].erase(owned[t].begin());
+						}
+					}
+				}));
+			}
+			for (std::thread& writer : writers)
+			{
+				writer.join();
+			}
+			done = true;
+			flusher.join();
+		}
+
+		{
+			File file39 = File::open(filename, backend);
+			std::vector<bool> seen(file39.numPages(), false);
+			std::size_t live = 0;
+			char expected[100];
+			for (unsigned t = 0; t < numThreads; t++)
+			{
+				for (const PageId pageNo : owned[t])
+				{
+					if (pageNo >= seen.size() || seen[pageNo])
+					{
+						PRINT_ERROR("ERROR :: Page allocated to two threads at once.");
+					}
+					seen[pageNo] = true;
+					sprintf(expected, "test.39 thread %u page %u", t, pageNo);
+					const Page p = file39.readPage(pageNo);
+					if (p.getRecord({pageNo, 1}) != expected)
+					{
+						PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+					}
+					live++;
+				}
+			}
+			std::size_t used = 0;
+			for (FileIterator iter = file39.begin(); iter != file39.end(); ++iter)
+			{
+				used++;
+			}
+			if (used != live)
+			{
+				PRINT_ERROR("ERROR :: File counts pages no thread owns.");
+			}
+		}
+		File::remove(filename);
+	}
+
+	std::cout << "Test 39 passed" << "\n";
+}
+
+void test40()
+{
+	// A writable mapping only reserves room for the file to grow by a given
+	// number of bytes past its size when opened, and writes beyond it fail.
+	// The room can be given to File::create() and File::open() too.
+	const std::string& filename = "test.40";
+	const std::uint64_t room = 4 * Page::SIZE;
+	std::vector<char> bytes(Page::SIZE);
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	for (int reopen = 0; reopen < 2; reopen++)
+	{
+		MmapFileIO io(filename, !reopen /* truncate */, false /* read_only */, room);
+		const std::uint64_t start = reopen * room;
+		for (std::uint64_t offset = start; offset < start + room; offset += Page::SIZE)
+		{
+			std::fill(bytes.begin(), bytes.end(), (char)(offset / Page::SIZE));
+			io.writeAt(&bytes[0], Page::SIZE, offset);
+		}
+		try
+		{
+			io.writeAt(&bytes[0], Page::SIZE, start + room);
+			PRINT_ERROR("ERROR :: Wrote past the room reserved for the file. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const FileIOException &e)
+		{
+		}
+	}
+	{
+		MmapFileIO io(filename, false /* truncate */, true /* read_only */);
+		for (std::uint64_t offset = 0; offset < 2 * room; offset += Page::SIZE)
+		{
+			if (io.readAt(&bytes[0], Page::SIZE, offset) != Page::SIZE ||
+				bytes[Page::SIZE - 1] != (char)(offset / Page::SIZE))
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+		if (io.readAt(&bytes[0], Page::SIZE, 2 * room) != 0)
+		{
+			PRINT_ERROR("ERROR :: File grew past the bytes written.");
+		}
+	}
+	File::remove(filename);
+
+	// the file's own room, with the header page in it, fills up first; with
+	// more room when reopened it grows further
+	PageId allocated[2] = {0, 0};
+	for (int reopen = 0; reopen < 2; reopen++)
+	{
+		File file40 = reopen ? File::open(filename, FileBackend::MMAP, 2 * room) :
+			File::create(filename, FileBackend::MMAP, room);
+		try
+		{
+			while (true)
+			{
+				file40.allocatePage();
+				allocated[reopen]++;
+			}
+		}
+		catch(const FileIOException &e)
+		{
+		}
+	}
+	if (allocated[0] != room / Page::SIZE - 1 || allocated[1] != 2 * room / Page::SIZE)
+	{
+		PRINT_ERROR("ERROR :: File did not grow by exactly the room it was given.");
+	}
+	File::remove(filename);
+
+	std::cout << "Test 40 passed" << "\n";
+}
+
+void test41()
+{
+	// flushFile on one file while other threads keep reading and dirtying
+	// pages of another file in a pool too small for both, so frames of the
+	// flushed file are evicted and reused for the other file during the
+	// flush.  No page may be written back into the wrong file.
+	const std::string names[] = {"test.41a", "test.41b"};
+	const PageId numPages = 30;
+	const int rounds = 1000;
+
+	for (const std::string& filename : names)
+	{
+		try
+		{
+			File::remove(filename);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+	}
+
+	{
+		File files[] = {File::create(names[0], FileBackend::DESCRIPTOR),
+			File::create(names[1], FileBackend::DESCRIPTOR)};
+		RecordId rids[2][numPages + 1];
+		BufMgr* mgr = new BufMgr(48);
+		for (int f = 0; f < 2; f++)
+		{
+			for (PageId j = 0; j < numPages; j++)
+			{
+				PageId pageNo;
+				Page* p;
+				mgr->allocPage(&files[f], pageNo, p);
+				sprintf((char*)tmpbuf, "%s Page %u", names[f].c_str(), pageNo);
+				rids[f][pageNo] = p->insertRecord(tmpbuf);
+				mgr->unPinPage(&files[f], pageNo, true);
+			}
+			mgr->flushFile(&files[f]);
+		}
+
+		std::atomic<bool> done(false);
+		std::vector<std::thread> readers;
+		for (unsigned t = 0; t < 2; t++)
+		{
+			readers.push_back(std::thread([&, t]()
+			{
+				std::minstd_rand rng(t + 1);
+				while (!done)
+				{
+					const PageId pageNo = 1 + rng() % numPages;
+					Page* p;
+					mgr->readPage(&files[1], pageNo, p);
+					mgr->unPinPage(&files[1], pageNo, true);
+				}
+			}));
+		}
+		std::minstd_rand rng(41);
+		for (int round = 0; round < rounds; round++)
+		{
+			for (int k = 0; k < 8; k++)
+			{
+				const PageId pageNo = 1 + rng() % numPages;
+				Page* p;
+				mgr->readPage(&files[0], pageNo, p);
+				mgr->unPinPage(&files[0], pageNo, true);
+			}
+			mgr->flushFile(&files[0]);
+		}
+		done = true;
+		for (std::thread& reader : readers)
+		{
+			reader.join();
+		}
+		mgr->flushFile(&files[1]);
+		delete mgr;
+
+		for (int f = 0; f < 2; f++)
+		{
+			for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+			{
+				sprintf((char*)tmpbuf, "%s Page %u", names[f].c_str(), pageNo);
+				if (files[f].readPage(pageNo).getRecord(rids[f][pageNo]) != (char*)tmpbuf)
+				{
+					PRINT_ERROR("ERROR :: Page was written back into the wrong file.");
+				}
+			}
+		}
+	}
+	for (const std::string& filename : names)
+	{
+		File::remove(filename);
+	}
+
+	std::cout << "Test 41 passed" << "\n";
+}
+
+void test42()
+{
+	// Switch a file between the hash table and a page table while other
+	// threads keep reading it.  Each switch either throws because a page is
+	// pinned or moves the file; readers must always see the right page.
+	const std::string filename = "test.42";
+	const PageId numPages = 30;
+	const int rounds = 500;
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file = File::create(filename, FileBackend::DESCRIPTOR);
+		RecordId rids[numPages + 1];
+		BufMgr* mgr = new BufMgr(48);
+		for (PageId j = 0; j < numPages; j++)
+		{
+			PageId pageNo;
+			Page* p;
+			mgr->allocPage(&file, pageNo, p);
+			sprintf((char*)tmpbuf, "test.42 Page %u", pageNo);
+			rids[pageNo] = p->insertRecord(tmpbuf);
+			mgr->unPinPage(&file, pageNo, true);
+		}
+		mgr->flushFile(&file);
+
+		std::atomic<bool> done(false);
+		std::atomic<int> wrongPages(0);
+		std::vector<std::thread> readers;
+		for (unsigned t = 0; t < 2; t++)
+		{
+			readers.push_back(std::thread([&, t]()
+			{
+				std::minstd_rand rng(t + 1);
+				char expected[64];
+				while (!done)
+				{
+					const PageId pageNo = 1 + rng() % numPages;
+					Page* p;
+					mgr->readPage(&file, pageNo, p);
+					sprintf(expected, "test.42 Page %u", pageNo);
+					if (p->getRecord(rids[pageNo]) != expected)
+					{
+						wrongPages++;
+					}
+					mgr->unPinPage(&file, pageNo, rng() % 4 == 0);
+					// leave gaps without pins for the switches to get through
+					std::this_thread::sleep_for(std::chrono::microseconds(20));
+				}
+			}));
+		}
+		int switches = 0;
+		for (int round = 0; round < rounds; round++)
+		{
+			try
+			{
+				if (round % 2 == 0)
+				{
+					mgr->enablePageTable(&file);
+				}
+				else
+				{
+					mgr->disablePageTable(&file);
+				}
+				switches++;
+			}
+			catch(const PagePinnedException &e)
+			{
+			}
+		}
+		done = true;
+		for (std::thread& reader : readers)
+		{
+			reader.join();
+		}
+		if (wrongPages > 0)
+		{
+			PRINT_ERROR("ERROR :: Reader saw the wrong page during a page table switch.");
+		}
+		if (switches == 0)
+		{
+			PRINT_ERROR("ERROR :: Page table never switched while the file was being read.");
+		}
+		mgr->disablePageTable(&file);
+		delete mgr;
+
+		for (PageId pageNo = 1; pageNo <= numPages; pageNo++)
+		{
+			sprintf((char*)tmpbuf, "test.42 Page %u", pageNo);
+			if (file.readPage(pageNo).getRecord(rids[pageNo]) != (char*)tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: Page lost during a page table switch.");
+			}
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 42 passed" << "\n";
+}
+
+void test43()
+{
+	// Converts a file written by hand in the baseline format, without magic
+	// number and with used and free pages chained in lists, and checks that
+	// the lists become the page map and records keep their IDs.
+	const std::string& filename = "test.43";
+
+	try
+	{
+		File::remove(filename);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	// header page, used pages 3 -> 1, free pages 4 -> 2
+	const char* const records[] = {"first", "second record", "third"};
+	std::vector<char> bytes(5 * Page::SIZE, 0);
+	const PageId fileHeader[] = {5, 3, 2, 4};
+	std::memcpy(&bytes[0], fileHeader, sizeof(fileHeader));
+	for (PageId pageNo = 1; pageNo < 5; pageNo++)
+	{
+		char* page = &bytes[pageNo * Page::SIZE];
+		const bool used = pageNo % 2 == 1;
+		const int numSlots = used ? 3 - pageNo / 2 : 0;
+		char* data = page + 16;
+		std::uint16_t upper = Page::SIZE - 16;
+		for (int i = 0; i < numSlots; i++)
+		{
+			const std::uint16_t length = std::strlen(records[i]);
+			upper -= length;
+			std::memcpy(data + upper, records[i], length);
+			char* slot = data + 6 * i;
+			slot[0] = 1;
+			std::memcpy(slot + 2, &upper, 2);
+			std::memcpy(slot + 4, &length, 2);
+		}
+		const std::uint16_t fields[] = {static_cast<std::uint16_t>(numSlots * 6), upper,
+			static_cast<std::uint16_t>(numSlots), 0};
+		const PageId next = pageNo > 2 ? pageNo - 2 : Page::INVALID_NUMBER;
+		const PageId links[] = {used ? pageNo : Page::INVALID_NUMBER, next};
+		std::memcpy(page, fields, sizeof(fields));
+		std::memcpy(page + 8, links, sizeof(links));
+	}
+
+	{
+		// a used list running into a cycle is rejected, leaving the file as it was
+		std::vector<char> broken(bytes);
+		const PageId cycle = 3;
+		std::memcpy(&broken[Page::SIZE + 12], &cycle, sizeof(cycle));
+		std::ofstream out(filename, std::ios::binary);
+		out.write(&broken[0], broken.size());
+	}
+	try
+	{
+		File::convert(filename);
+		PRINT_ERROR("ERROR :: Converted a file with a broken page list.");
+	}
+	catch(const InvalidFileFormatException &e)
+	{
+	}
+	{
+		std::ifstream in(filename, std::ios::binary);
+		PageId numPages = 0;
+		in.read(reinterpret_cast<char*>(&numPages), sizeof(numPages));
+		if (numPages != 5 || File::exists(filename + ".convert"))
+		{
+			PRINT_ERROR("ERROR :: Failed conversion changed the file.");
+		}
+	}
+
+	{
+		std::ofstream out(filename, std::ios::binary);
+		out.write(&bytes[0], bytes.size());
+	}
+	File::convert(filename);
+	File::convert(filename);
+	{
+		File file43 = File::open(filename);
+		std::vector<PageId> usedPages;
+		for (FileIterator iter = file43.begin(); iter != file43.end(); ++iter)
+		{
+			usedPages.push_back((*iter).page_number());
+		}
+		if (usedPages != std::vector<PageId>{1, 3})
+		{
+			PRINT_ERROR("ERROR :: Converted file has the wrong used pages.");
+		}
+
+		const Page p1 = file43.readPage(1);
+		const Page p3 = file43.readPage(3);
+		if (p1.getRecord({1, 1}) != records[0] || p1.getRecord({1, 2}) != records[1] ||
+			p1.getRecord({1, 3}) != records[2] || p3.getRecord({3, 1}) != records[0] ||
+			p3.getRecord({3, 2}) != records[1])
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+
+		// the free pages are reused before the file grows
+		const PageId first = file43.allocatePage().page_number();
+		const PageId second = file43.allocatePage().page_number();
+		if (std::min(first, second) != 2 || std::max(first, second) != 4 ||
+			file43.allocatePage().page_number() != 5)
+		{
+			PRINT_ERROR("ERROR :: Converted file did not reuse free pages.");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 43 passed" << "\n";
+}
@@ -0,0 +1,136 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "mmap_file_io.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "exceptions/file_io_exception.h"
+
+namespace badgerdb {
+
+const std::uint64_t MmapFileIO::GROWTH_STEP;
+
+MmapFileIO::MmapFileIO(const std::string& filename, const bool truncate,
+                       const bool read_only, const std::uint64_t growth_room)
+    : FileIO(filename),
+      read_only_(read_only) {
+  int flags = read_only_ ? O_RDONLY : O_RDWR | O_CREAT;
+  if (truncate) {
+    flags |= O_TRUNC;
+  }
+  fd_ = ::open(filename_.c_str(), flags, 0644);
+  if (fd_ < 0) {
+    throw FileIOException(filename_, "open", errno);
+  }
+  struct stat info;
+  if (::fstat(fd_, &info) != 0) {
+    const int error = errno;
+    ::close(fd_);
+    throw FileIOException(filename_, "open", error);
+  }
+  size_ = info.st_size;
+  file_size_ = info.st_size;
+
+  // A writable file gets room to grow; mmap() refuses empty mappings.
+  mapped_size_ = std::max<std::uint64_t>(
+      info.st_size + (read_only_ ? 0 : growth_room), 1);
+  void* base = ::mmap(NULL, mapped_size_,
+                      read_only_ ? PROT_READ : PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd_, 0);
+  if (base == MAP_FAILED) {
+    const int error = errno;
+    ::close(fd_);
+    throw FileIOException(filename_, "map", error);
+  }
+  base_ = static_cast<char*>(base);
+}
+
+MmapFileIO::~MmapFileIO() {
+  ::munmap(base_, mapped_size_);
+  if (file_size_ != size_) {
+    // Drop the unused part of the last growth step.  If that fails the file
+    // just keeps some trailing zeros.
+    const int result = ::ftruncate(fd_, size_);
+    (void)result;
+  }
+  ::close(fd_);
+}
+
+std::size_t MmapFileIO::readAt(char* buffer, const std::size_t length,
+                               const std::uint64_t offset) {
+  const std::uint64_t size = size_;
+  if (offset >= size) {
+    return 0;
+  }
+  const std::size_t count = std::min<std::uint64_t>(length, size - offset);
+  std::memcpy(buffer, base_ + offset, count);
+  return count;
+}
+
+void MmapFileIO::writeAt(const char* buffer, const std::size_t length,
+                         const std::uint64_t offset) {
+  if (read_only_) {
+    throw FileIOException(filename_, "write", EBADF);
+  }
+  const std::uint64_t end = offset + length;
+  if (end > file_size_) {
+    reserve(end);
+  }
+  std::memcpy(base_ + offset, buffer, length);
+  // Make the bytes visible to readers only once they are in place.
+  std::uint64_t size = size_;
+  while (size < end && !size_.compare_exchange_weak(size, end)) {
+  }
+}
+
+void MmapFileIO::reserve(const std::uint64_t end) {
+  std::lock_guard<std::mutex> guard(grow_latch_);
+  if (end <= file_size_) {
+    // Another thread grew the file meanwhile.
+    return;
+  }
+  if (end > mapped_size_) {
+    throw FileIOException(filename_, "write", EFBIG);
+  }
+  // Grow by at least an eighth of the file so appending a page at a time
+  // rarely needs a system call.
+  std::uint64_t new_size = std::max(end, file_size_ + std::max(
+      GROWTH_STEP, static_cast<std::uint64_t>(file_size_ / 8)));
+  new_size = std::min(new_size, mapped_size_);
+  if (::ftruncate(fd_, new_size) != 0) {
+    throw FileIOException(filename_, "extend", errno);
+  }
+  file_size_ = new_size;
+}
+
+void MmapFileIO::sync() {
+  if (read_only_ || size_ == 0) {
+    return;
+  }
+  if (::msync(base_, size_, MS_SYNC) != 0) {
+    throw FileIOException(filename_, "sync", errno);
+  }
+}
+
+void MmapFileIO::advise(const AccessPattern pattern) {
+  int advice = MADV_NORMAL;
+  if (pattern == AccessPattern::SEQUENTIAL) {
+    advice = MADV_SEQUENTIAL;
+  } else if (pattern == AccessPattern::RANDOM) {
+    advice = MADV_RANDOM;
+  }
+  ::madvise(base_, mapped_size_, advice);
+}
+
+}
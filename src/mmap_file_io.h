@@ -0,0 +1,126 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "file_io.h"
+
+namespace badgerdb {
+
+/**
+ * @brief FileIO on a shared memory mapping of the file.
+ *
+ * A writable file is mapped with room to grow by a fixed number of bytes,
+ * FileIO::DEFAULT_GROWTH_ROOM unless the constructor is given another
+ * amount, e.g. through File::create() or File::open(), so
+ * the file can grow without the mapping ever moving and pointers returned
+ * through mapping() stay valid while the file is open.  The room is only
+ * address space; nothing is allocated until the file grows into it.  The file
+ * itself is grown in steps of at least GROWTH_STEP bytes and cut back to the
+ * bytes actually written when it is closed.  A read-only file is mapped at
+ * its current size.
+ *
+ * Reads and writes are plain copies from and to the mapping, so threads can
+ * access the file concurrently.
+ */
+class MmapFileIO : public FileIO {
+ public:
+  /**
+   * Smallest number of bytes a writable file is extended by at once.
+   */
+  static const std::uint64_t GROWTH_STEP = 1 << 20;
+
+  /**
+   * Opens and maps the file.
+   *
+   * @param filename  Name of the file.
+   * @param truncate  Whether to discard the existing contents of the file.
+   * @param read_only Whether to map the file read-only.
+   * @param growth_room Number of bytes a writable file can grow by, beyond
+   *                    its size when opened, before writes fail.
+   * @throws  FileIOException   If the file can't be opened or mapped.
+   */
+  MmapFileIO(const std::string& filename, const bool truncate,
+             const bool read_only,
+             const std::uint64_t growth_room = DEFAULT_GROWTH_ROOM);
+
+  /**
+   * Unmaps the file, cuts it back to the bytes written and closes it.
+   */
+  ~MmapFileIO();
+
+  FileBackend backend() const override {
+    return read_only_ ? FileBackend::MMAP_READ_ONLY : FileBackend::MMAP;
+  }
+
+  std::size_t readAt(char* buffer, const std::size_t length,
+                     const std::uint64_t offset) override;
+
+  /**
+   * @throws  FileIOException   If the file is read-only, would grow past
+   *                            the mapping or can't be extended.
+   */
+  void writeAt(const char* buffer, const std::size_t length,
+               const std::uint64_t offset) override;
+
+  void sync() override;
+
+  void advise(const AccessPattern pattern) override;
+
+  const char* mapping() const override { return base_; }
+
+ private:
+  /**
+   * Makes the file at least end bytes long.
+   *
+   * @param end   Offset just past the last byte that is going to be written.
+   * @throws  FileIOException   If the file can't be extended.
+   */
+  void reserve(const std::uint64_t end);
+
+  /**
+   * Descriptor of the open file.
+   */
+  int fd_;
+
+  /**
+   * Whether the file is mapped read-only.
+   */
+  const bool read_only_;
+
+  /**
+   * Start of the mapping.
+   */
+  char* base_;
+
+  /**
+   * Length of the mapping.
+   */
+  std::uint64_t mapped_size_;
+
+  /**
+   * Offset just past the last byte written or present when opened; reads
+   * stop here.
+   */
+  std::atomic<std::uint64_t> size_;
+
+  /**
+   * Current length of the file on disk, at least size_.
+   */
+  std::atomic<std::uint64_t> file_size_;
+
+  /**
+   * Serializes extending the file.
+   */
+  std::mutex grow_latch_;
+};
+
+}
@@ -5,7 +5,9 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_record_exception.h"
@@ -16,6 +18,37 @@
 
 namespace badgerdb {
 
+const std::size_t PageHeader::SLOT_BITMAP_WORDS;
+const SlotId Page::MAX_SLOTS;
+
+namespace {
+
+/**
+ * Leading fields of the page header, the same in every format version.
+ */
+struct LegacyPageHeader {
+  std::uint16_t free_space_lower_bound;
+  std::uint16_t free_space_upper_bound;
+  SlotId num_slots;
+  SlotId num_free_slots;
+  PageId current_page_number;
+  PageId next_page_number;  // Only used in version 1.
+};
+
+/**
+ * Slot of file format versions 1 to 3.
+ */
+struct LegacyPageSlot {
+  bool used;
+  std::uint16_t item_offset;
+  std::uint16_t item_length;
+};
+
+static_assert(sizeof(LegacyPageHeader) == 16 && sizeof(LegacyPageSlot) == 6,
+              "Legacy structures must match the old on-disk layout.");
+
+}
+
 Page::Page() {
   initialize();
 }
@@ -26,41 +59,89 @@ void Page::initialize() {
   header_.num_slots = 0;
   header_.num_free_slots = 0;
   header_.current_page_number = INVALID_NUMBER;
-  header_.next_page_number = INVALID_NUMBER;
-  data_.assign(DATA_SIZE, char());
+  header_.fragmented_space = 0;
+  header_.reserved = 0;
+  std::memset(header_.used_slots, 0, sizeof(header_.used_slots));
+  std::memset(data_, 0, DATA_SIZE);
 }
 
 RecordId Page::insertRecord(const std::string& record_data) {
-  if (!hasSpaceForRecord(record_data)) {
-    throw InsufficientSpaceException(
-        page_number(), record_data.length(), getFreeSpace());
+  return insertRecord(record_data.data(), record_data.length());
+}
+
+RecordId Page::insertRecord(const char* data, const std::size_t length) {
+  if (!hasSpaceForRecord(length)) {
+    throw InsufficientSpaceException(page_number(), length, getFreeSpace());
+  }
+  // Room for a new slot has to be contiguous with the slot array before the
+  // slot is allocated.
+  const std::size_t needed =
+      length + (header_.num_free_slots == 0 ? sizeof(PageSlot) : 0);
+  if (static_cast<std::size_t>(header_.free_space_upper_bound -
+                               header_.free_space_lower_bound) < needed) {
+    compact();
   }
   const SlotId slot_number = getAvailableSlot();
-  insertRecordInSlot(slot_number, record_data);
+  insertRecordInSlot(slot_number, data, length);
   return {page_number(), slot_number};
 }
 
 std::string Page::getRecord(const RecordId& record_id) const {
+  return viewRecord(record_id).str();
+}
+
+RecordView Page::viewRecord(const RecordId& record_id) const {
   validateRecordId(record_id);
   const PageSlot& slot = getSlot(record_id.slot_number);
-  return data_.substr(slot.item_offset, slot.item_length);
+  const RecordView record = {&data_[slot.item_offset], slot.item_length};
+  return record;
 }
 
 void Page::updateRecord(const RecordId& record_id,
                         const std::string& record_data) {
+  updateRecord(record_id, record_data.data(), record_data.length());
+}
+
+void Page::updateRecord(const RecordId& record_id, const char* data,
+                        const std::size_t length) {
   validateRecordId(record_id);
-  const PageSlot* slot = getSlot(record_id.slot_number);
+  PageSlot* slot = getSlot(record_id.slot_number);
+  if (length <= slot->item_length) {
+    // Overwrite in place; the bytes left over at the end are freed.
+    std::memmove(&data_[slot->item_offset], data, length);
+    header_.fragmented_space += slot->item_length - length;
+    slot->item_length = length;
+    return;
+  }
+  const std::size_t growth = length - slot->item_length;
+  if (slot->item_offset == header_.free_space_upper_bound &&
+      static_cast<std::size_t>(header_.free_space_upper_bound -
+                               header_.free_space_lower_bound) >= growth) {
+    // Lowest record on the page, so it can grow into the free space below.
+    slot->item_offset -= growth;
+    slot->item_length = length;
+    header_.free_space_upper_bound = slot->item_offset;
+    std::memmove(&data_[slot->item_offset], data, length);
+    return;
+  }
   const std::size_t free_space_after_delete =
       getFreeSpace() + slot->item_length;
-  if (record_data.length() > free_space_after_delete) {
+  if (length > free_space_after_delete) {
     throw InsufficientSpaceException(
-        page_number(), record_data.length(), free_space_after_delete);
+        page_number(), length, free_space_after_delete);
+  }
+  // Making room for the new version may compact the page and move records
+  // around, so new data that lives on this page is set aside first.
+  char copy[DATA_SIZE];
+  if (data >= data_ && data < data_ + DATA_SIZE) {
+    std::memcpy(copy, data, length);
+    data = copy;
   }
   // We have to disallow slot compaction here because we're going to place the
   // record data in the same slot, and compaction might delete the slot if we
   // permit it.
   deleteRecord(record_id, false /* allow_slot_compaction */);
-  insertRecordInSlot(record_id.slot_number, record_data);
+  insertRecordInSlot(record_id.slot_number, data, length);
 }
 
 void Page::deleteRecord(const RecordId& record_id) {
@@ -71,32 +152,16 @@ void Page::deleteRecord(const RecordId& record_id,
                         const bool allow_slot_compaction) {
   validateRecordId(record_id);
   PageSlot* slot = getSlot(record_id.slot_number);
-  data_.replace(slot->item_offset, slot->item_length, slot->item_length, '\0');
-
-  // Compact the data by removing the hole left by this record (if necessary).
-  std::uint16_t move_offset = slot->item_offset; 
-  std::size_t move_bytes = 0;
-  for (SlotId i = 1; i <= header_.num_slots; ++i) {
-    PageSlot* other_slot = getSlot(i);
-    if (other_slot->used && other_slot->item_offset < slot->item_offset) {
-      if (other_slot->item_offset < move_offset) {
-        move_offset = other_slot->item_offset;
-      }
-      move_bytes += other_slot->item_length;
-      // Update the slot for the other data to reflect the soon-to-be-new
-      // location.
-      other_slot->item_offset += slot->item_length;
-    }
-  }
-  // If we have data to move, shift it to the right.
-  if (move_bytes > 0) {
-    const std::string& data_to_move = data_.substr(move_offset, move_bytes);
-    data_.replace(move_offset + slot->item_length, move_bytes, data_to_move);
+  if (slot->item_offset == header_.free_space_upper_bound) {
+    // Lowest record on the page, so its space joins the free space directly.
+    std::memset(&data_[slot->item_offset], 0, slot->item_length);
+    header_.free_space_upper_bound += slot->item_length;
+  } else {
+    header_.fragmented_space += slot->item_length;
   }
-  header_.free_space_upper_bound += slot->item_length;
 
   // Mark slot as unused.
-  slot->used = false;
+  setSlotUsed(record_id.slot_number, false);
   slot->item_offset = 0;
   slot->item_length = 0;
   ++header_.num_free_slots;
@@ -107,8 +172,7 @@ void Page::deleteRecord(const RecordId& record_id,
     int num_slots_to_delete = 1;
     for (SlotId i = 1; i < header_.num_slots; ++i) {
       // Traverse list backwards, looking for unused slots.
-      const PageSlot* other_slot = getSlot(header_.num_slots - i);
-      if (!other_slot->used) {
+      if (!isSlotUsed(header_.num_slots - i)) {
         ++num_slots_to_delete;
       } else {
         // Stop at the first used slot we find, since we can't move used slots
@@ -122,9 +186,44 @@ void Page::deleteRecord(const RecordId& record_id,
   }
 }
 
+void Page::compact() {
+  // Move records in order of descending offset, so that every record only
+  // moves towards the end of the page, over bytes that are already free.
+  SlotId order[DATA_SIZE / sizeof(PageSlot)];
+  std::size_t count = 0;
+  for (SlotId i = findSlot(0, true /* used */); i != INVALID_SLOT;
+       i = findSlot(i, true /* used */)) {
+    order[count++] = i;
+  }
+  std::sort(order, order + count, [this](const SlotId a, const SlotId b) {
+    return getSlot(a)->item_offset > getSlot(b)->item_offset;
+  });
+  std::uint16_t upper_bound = DATA_SIZE;
+  for (std::size_t i = 0; i < count; ++i) {
+    PageSlot* slot = getSlot(order[i]);
+    upper_bound -= slot->item_length;
+    if (slot->item_offset != upper_bound) {
+      std::memmove(&data_[upper_bound], &data_[slot->item_offset],
+                   slot->item_length);
+      slot->item_offset = upper_bound;
+    }
+  }
+  std::memset(&data_[header_.free_space_upper_bound], 0,
+              upper_bound - header_.free_space_upper_bound);
+  header_.free_space_upper_bound = upper_bound;
+  header_.fragmented_space = 0;
+}
+
 bool Page::hasSpaceForRecord(const std::string& record_data) const {
-  std::size_t record_size = record_data.length();
+  return hasSpaceForRecord(record_data.length());
+}
+
+bool Page::hasSpaceForRecord(const std::size_t length) const {
+  std::size_t record_size = length;
   if (header_.num_free_slots == 0) {
+    if (header_.num_slots == MAX_SLOTS) {
+      return false;
+    }
     record_size += sizeof(PageSlot);
   }
   return record_size <= getFreeSpace();
@@ -141,16 +240,10 @@ const PageSlot& Page::getSlot(const SlotId slot_number) const {
 SlotId Page::getAvailableSlot() {
   SlotId slot_number = INVALID_SLOT;
   if (header_.num_free_slots > 0) {
-    // Have an allocated but unused slot that we can reuse.
-    for (SlotId i = 1; i <= header_.num_slots; ++i) {
-      const PageSlot* slot = getSlot(i);
-      if (!slot->used) {
-        // We don't decrement the number of free slots until someone actually
-        // puts data in the slot.
-        slot_number = i;
-        break;
-      }
-    }
+    // Have an allocated but unused slot that we can reuse.  We don't
+    // decrement the number of free slots until someone actually puts data in
+    // the slot.
+    slot_number = findSlot(0, false /* used */);
   } else {
     // Have to allocate a new slot.
     slot_number = header_.num_slots + 1;
@@ -162,40 +255,94 @@ SlotId Page::getAvailableSlot() {
   return slot_number;
 }
 
-void Page::insertRecordInSlot(const SlotId slot_number,
-                              const std::string& record_data) {
+void Page::insertRecordInSlot(const SlotId slot_number, const char* data,
+                              const std::size_t length) {
   if (slot_number > header_.num_slots ||
       slot_number == INVALID_SLOT) {
     throw InvalidSlotException(page_number(), slot_number);
   }
   PageSlot* slot = getSlot(slot_number);
-  if (slot->used) {
+  if (isSlotUsed(slot_number)) {
     throw SlotInUseException(page_number(), slot_number);
   }
-  const int record_length = record_data.length();
-  slot->used = true;
+  if (static_cast<std::size_t>(header_.free_space_upper_bound -
+                               header_.free_space_lower_bound) < length) {
+    compact();
+  }
+  const int record_length = length;
+  setSlotUsed(slot_number, true);
   slot->item_length = record_length;
   slot->item_offset = header_.free_space_upper_bound - record_length;
   header_.free_space_upper_bound = slot->item_offset;
   --header_.num_free_slots;
-  data_.replace(slot->item_offset, slot->item_length, record_data);
+  std::memcpy(&data_[slot->item_offset], data, slot->item_length);
 }
 
 void Page::validateRecordId(const RecordId& record_id) const {
   if (record_id.page_number != page_number()) {
     throw InvalidRecordException(record_id, page_number());
   }
-  const PageSlot& slot = getSlot(record_id.slot_number);
-  if (!slot.used) {
+  if (record_id.slot_number == INVALID_SLOT ||
+      record_id.slot_number > header_.num_slots ||
+      !isSlotUsed(record_id.slot_number)) {
     throw InvalidRecordException(record_id, page_number());
   }
 }
 
-PageIterator Page::begin() {
+void Page::setSlotUsed(const SlotId slot_number, const bool used) {
+  const std::uint64_t bit = static_cast<std::uint64_t>(1)
+                            << ((slot_number - 1) % 64);
+  if (used) {
+    header_.used_slots[(slot_number - 1) / 64] |= bit;
+  } else {
+    header_.used_slots[(slot_number - 1) / 64] &= ~bit;
+  }
+}
+
+bool Page::convertFrom(const char* old_page, const std::uint32_t version) {
+  LegacyPageHeader old_header;
+  std::memcpy(&old_header, old_page, sizeof(old_header));
+  // Version 3 added the used-slot bitmap, so its header is as long as now.
+  const std::size_t data_offset =
+      version <= 2 ? sizeof(LegacyPageHeader) : sizeof(PageHeader);
+  const char* old_data = old_page + data_offset;
+  const std::size_t old_data_size = SIZE - data_offset;
+
+  initialize();
+  set_page_number(old_header.current_page_number);
+  if (old_header.current_page_number == INVALID_NUMBER) {
+    // Free page.
+    return true;
+  }
+  if (old_header.num_slots > MAX_SLOTS ||
+      old_header.num_slots * sizeof(LegacyPageSlot) > old_data_size) {
+    return false;
+  }
+  // Allocate all slots up front, so that records keep their slot numbers.
+  header_.num_slots = old_header.num_slots;
+  header_.num_free_slots = old_header.num_slots;
+  header_.free_space_lower_bound = sizeof(PageSlot) * header_.num_slots;
+  for (SlotId i = 1; i <= old_header.num_slots; ++i) {
+    LegacyPageSlot slot;
+    std::memcpy(&slot, &old_data[(i - 1) * sizeof(LegacyPageSlot)],
+                sizeof(slot));
+    if (!slot.used) {
+      continue;
+    }
+    if (slot.item_offset + slot.item_length > old_data_size ||
+        slot.item_length > getFreeSpace()) {
+      return false;
+    }
+    insertRecordInSlot(i, &old_data[slot.item_offset], slot.item_length);
+  }
+  return true;
+}
+
+PageIterator Page::begin() const {
   return PageIterator(this);
 }
 
-PageIterator Page::end() {
+PageIterator Page::end() const {
   const RecordId& end_record_id = {page_number(), Page::INVALID_SLOT};
   return PageIterator(this, end_record_id);
 }
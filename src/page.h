@@ -23,6 +23,12 @@ namespace badgerdb {
  * contains a pointer to the next page in the file.
  */
 struct PageHeader {
+  /**
+   * Number of 64-bit words in used_slots, and so Page::MAX_SLOTS / 64.  Only
+   * pages of records shorter than 2 bytes need more slots than that.
+   */
+  static const std::size_t SLOT_BITMAP_WORDS = 21;
+
   /**
    * Lower bound of the free space.  This is the offset of the first unused byte
    * after the slot array.
@@ -53,9 +59,25 @@ struct PageHeader {
   PageId current_page_number;
 
   /**
-   * Number of the next used page in the file.
+   * Bytes of deleted records between the upper bound of the free space and the
+   * end of the page.  They are free, but only become part of the contiguous
+   * free space when the page is compacted.
+   */
+  std::uint16_t fragmented_space;
+
+  /**
+   * Unused.  Together with fragmented_space formerly the number of the next
+   * used page in the file, before files tracked their used pages in free-space
+   * map pages.
    */
-  PageId next_page_number;
+  std::uint16_t reserved;
+
+  /**
+   * Bitmap with one bit per allocated slot, set while the slot holds a
+   * record.  Slot i is bit (i - 1) % 64 of word (i - 1) / 64; bits of slots
+   * that are not allocated are clear.
+   */
+  std::uint64_t used_slots[SLOT_BITMAP_WORDS];
 
   /**
    * Returns true if this page header is equal to the other.
@@ -66,21 +88,17 @@ struct PageHeader {
   bool operator==(const PageHeader& rhs) const {
     return num_slots == rhs.num_slots &&
         num_free_slots == rhs.num_free_slots &&
-        current_page_number == rhs.current_page_number &&
-        next_page_number == rhs.next_page_number;
+        current_page_number == rhs.current_page_number;
   }
 };
 
 /**
  * @brief Slot metadata that tracks where a record is in the data space.
+ *
+ * Whether the slot holds a record is kept in PageHeader::used_slots; both
+ * fields of an unused slot are 0.
  */
 struct PageSlot {
-  /**
-   * Whether the slot currently holds data.  May be false if this slot's
-   * record has been deleted after insertion.
-   */
-  bool used;
-
   /**
    * Offset of the data item in the page.
    */
@@ -92,6 +110,57 @@ struct PageSlot {
   std::uint16_t item_length;
 };
 
+/**
+ * @brief Non-owning view of the bytes of a record on a page.
+ *
+ * Points into the page itself, so it is only valid as long as the page is not
+ * changed, moved or released; for a page in the buffer pool, while the page
+ * stays pinned and nobody modifies it.
+ */
+struct RecordView {
+  /**
+   * First byte of the record.
+   */
+  const char* data;
+
+  /**
+   * Number of bytes in the record.
+   */
+  std::size_t length;
+
+  /**
+   * Returns the number of bytes in the record.
+   */
+  std::size_t size() const { return length; }
+
+  /**
+   * Returns a pointer to the first byte of the record.
+   */
+  const char* begin() const { return data; }
+
+  /**
+   * Returns a pointer just past the last byte of the record.
+   */
+  const char* end() const { return data + length; }
+
+  /**
+   * Returns a copy of the record.
+   */
+  std::string str() const { return std::string(data, length); }
+
+  /**
+   * Returns true if the record has the same bytes as the given string.
+   *
+   * @param rhs   String to compare against.
+   * @return  Whether the bytes are equal.
+   */
+  bool operator==(const std::string& rhs) const {
+    return rhs.compare(0, std::string::npos, data, length) == 0;
+  }
+
+  bool operator!=(const std::string& rhs) const { return !(*this == rhs); }
+};
+
 class PageIterator;
 
 /**
@@ -127,6 +196,12 @@ class Page {
    */
   static const SlotId INVALID_SLOT = 0;
 
+  /**
+   * Largest number of slots a page can have, one per bit of
+   * PageHeader::used_slots.
+   */
+  static const SlotId MAX_SLOTS = PageHeader::SLOT_BITMAP_WORDS * 64;
+
   /**
    * Constructs a new, uninitialized page.
    */
@@ -140,6 +215,15 @@ class Page {
    */
   RecordId insertRecord(const std::string& record_data);
 
+  /**
+   * Inserts a new record into the page.
+   *
+   * @param data    First byte of the record.
+   * @param length  Number of bytes in the record.
+   * @return  ID of the newly inserted record.
+   */
+  RecordId insertRecord(const char* data, const std::size_t length);
+
   /**
    * Returns the record with the given ID.  Returned data is a copy of what is
    * stored on the page; use updateRecord to change it.
@@ -150,20 +234,46 @@ class Page {
    */
   std::string getRecord(const RecordId& record_id) const;
 
+  /**
+   * Returns a view of the record with the given ID without copying it.  The
+   * view points into this page; see RecordView for how long it stays valid.
+   *
+   * @see getRecord
+   * @param record_id  ID of the record to return.
+   * @return  View of the record.
+   */
+  RecordView viewRecord(const RecordId& record_id) const;
+
   /**
    * Updates the record with the given ID, replacing its data with a new
    * version.  This is equivalent to deleting the old record and inserting a
    * new one, with the exception that the record ID will not change.
    *
+   * A new version that is no longer than the old one overwrites it in place,
+   * and the lowest record on the page grows into the free space next to it.
+   * Otherwise the record is moved.
+   *
    * @param record_id   ID of record to update.
    * @param record_data Updated bytes that compose the record.
    */
   void updateRecord(const RecordId& record_id, const std::string& record_data);
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array.
+   * Updates the record with the given ID, replacing its data with a new
+   * version.  The new bytes may come from a view of a record on this page.
+   *
+   * @param record_id   ID of record to update.
+   * @param data        First byte of the updated record.
+   * @param length      Number of bytes in the updated record.
+   */
+  void updateRecord(const RecordId& record_id, const char* data,
+                    const std::size_t length);
+
+  /**
+   * Deletes the record with the given ID.  The space of the record is freed,
+   * but other records are only moved to close the gap once an insert or
+   * update needs the space.  Slot array is compacted if the slot deleted is at
+   * the end of the slot array.
    *
    * @param record_id   ID of the record to delete.
    */
@@ -177,13 +287,23 @@ class Page {
    */
   bool hasSpaceForRecord(const std::string& record_data) const;
 
+  /**
+   * Returns true if the page has enough free space to hold a record of the
+   * given length.
+   *
+   * @param length  Number of bytes in the record.
+   * @return  Whether the page can hold the record.
+   */
+  bool hasSpaceForRecord(const std::size_t length) const;
+
   /**
    * Returns this page's free space in bytes.
    *
    * @return  Free space in bytes.
    */
   std::uint16_t getFreeSpace() const { return header_.free_space_upper_bound -
-                                              header_.free_space_lower_bound; }
+                                              header_.free_space_lower_bound +
+                                              header_.fragmented_space; }
 
   /**
    * Returns this page's number in its file.
@@ -192,19 +312,12 @@ class Page {
    */
   PageId page_number() const { return header_.current_page_number; }
 
-  /**
-   * Returns the number of the next used page this page in its file.
-   *
-   * @return  Page number of next used page in file.
-   */
-  PageId next_page_number() const { return header_.next_page_number; }
-
   /**
    * Returns an iterator at the first record in the page.
    *
    * @return  Iterator at first record of page.
    */
-  PageIterator begin();
+  PageIterator begin() const;
 
   /**
    * Returns an iterator representing the record after the last record in the
@@ -212,7 +325,7 @@ class Page {
    *
    * @return  Iterator representing record after the last record in the page.
    */
-  PageIterator end();
+  PageIterator end() const;
 
  private:
   /**
@@ -230,19 +343,16 @@ class Page {
   }
 
   /**
-   * Sets the number of the next used page after this page in its file.
-   *
-   * @param next_page_number  Page number of next used page in file.
+   * Moves the data of all records to the end of the page so that the space of
+   * deleted records becomes part of the contiguous free space.  Record IDs do
+   * not change.
    */
-  void set_next_page_number(const PageId new_next_page_number) {
-    header_.next_page_number = new_next_page_number;
-  }
+  void compact();
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array and
-   * <allow_slot_compaction> is set.
+   * Deletes the record with the given ID.  The space of the record is freed
+   * without moving other records.  Slot array is compacted if the slot deleted
+   * is at the end of the slot array and <allow_slot_compaction> is set.
    *
    * @param record_id             ID of the record to delete.
    * @param allow_slot_compaction If true, the slot array will be compacted if
@@ -295,13 +405,14 @@ class Page {
    * record before calling this method.
    *
    * @param slot_number   Number of slot to insert record into.
-   * @param record_data   Bytes that compose the record.
+   * @param data          First byte of the record.
+   * @param length        Number of bytes in the record.
    * @throws  InvalidSlotException  Thrown when given slot number refers to an
    *                                unallocated slot.
    * @throws  SlotInUseException  Thrown when given slot is in use.
    */
-  void insertRecordInSlot(const SlotId slot_number,
-                          const std::string& record_data);
+  void insertRecordInSlot(const SlotId slot_number, const char* data,
+                          const std::size_t length);
 
   /**
    * Throws an exception if the given record ID is not valid for this page
@@ -313,6 +424,64 @@ class Page {
    */
   void validateRecordId(const RecordId& record_id) const;
 
+  /**
+   * Returns whether the given allocated slot holds a record.
+   *
+   * @param slot_number   Number of slot to check.
+   * @return  True if the slot is in use.
+   */
+  bool isSlotUsed(const SlotId slot_number) const {
+    return (header_.used_slots[(slot_number - 1) / 64] >>
+            ((slot_number - 1) % 64)) & 1;
+  }
+
+  /**
+   * Marks the given allocated slot as in use or unused.
+   *
+   * @param slot_number   Number of slot to mark.
+   * @param used          Whether the slot now holds a record.
+   */
+  void setSlotUsed(const SlotId slot_number, const bool used);
+
+  /**
+   * Rebuilds this page from a page written with the layout of an older file
+   * format version, keeping its page number and record IDs.  Pages before
+   * version 3 have no used-slot bitmap, and versions 1 to 3 use 6-byte slots
+   * with a used flag.
+   *
+   * @param old_page  Bytes of the old page.
+   * @param version   File format version the old page was written with.
+   * @return  False if the old page is corrupt or holds more than fits in a
+   *          page now.
+   */
+  bool convertFrom(const char* old_page, const std::uint32_t version);
+
+  /**
+   * Returns the first allocated slot after the given one that is in use, or
+   * that is unused.  Scans the bitmap a word at a time.
+   *
+   * @param start   Slot to start search after; 0 to search from the first.
+   * @param used    Whether to look for a used or an unused slot.
+   * @return  Number of the slot found or Page::INVALID_SLOT if there is none.
+   */
+  SlotId findSlot(const SlotId start, const bool used) const {
+    const std::size_t end = header_.num_slots;
+    std::size_t bit = start;
+    while (bit < end) {
+      std::uint64_t word = header_.used_slots[bit / 64];
+      if (!used) {
+        word = ~word;
+      }
+      word &= ~static_cast<std::uint64_t>(0) << (bit % 64);
+      if (word != 0) {
+        bit = bit / 64 * 64 + __builtin_ctzll(word);
+        return bit < end ? bit + 1 : INVALID_SLOT;
+      }
+      bit = (bit / 64 + 1) * 64;
+    }
+    return INVALID_SLOT;
+  }
+
   /**
    * Returns whether the page is in use or is a free page.
    *
@@ -327,12 +496,25 @@ class Page {
 
   /**
    * Data stored on the page.  Includes bookkeeping information about slots as
-   * well as actual content.
+   * well as actual content.  Stored inline, so a Page is laid out exactly as
+   * the page is on disk.
    */
+  char data_[DATA_SIZE];
 
-  std::string data_;
+  /**
+   * Tag selecting the constructor that leaves a page uninitialized.
+   */
+  struct NoInit {};
+
+  /**
+   * Constructs a page without touching its memory.  Used by BufMgr for
+   * frames, and by File for pages it is about to read or initialize, whose
+   * contents are always overwritten before use.
+   */
+  explicit Page(NoInit) {}
 
   friend class File;
+  friend class BufMgr;
   friend class PageIterator;
   friend class PageTest;
   friend class BufferTest;
@@ -342,5 +524,11 @@ static_assert(Page::SIZE > sizeof(PageHeader),
               "Page size must be large enough to hold header and data.");
 static_assert(Page::DATA_SIZE > 0,
               "Page must have some space to hold data.");
+static_assert(sizeof(PageSlot) == 4,
+              "Slots must be packed into 4 bytes.");
+static_assert(Page::MAX_SLOTS >= Page::DATA_SIZE / (sizeof(PageSlot) + 2),
+              "Pages of records of 2 bytes or more must not run out of slots.");
+static_assert(sizeof(Page) == Page::SIZE,
+              "Page must have the same layout in memory as on disk.");
 
 }
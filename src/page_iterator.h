@@ -36,7 +36,7 @@ class PageIterator {
    *
    * @param page  Page to iterate over.
    */
-  PageIterator(Page* page)
+  PageIterator(const Page* page)
       : page_(page)  {
     assert(page_ != NULL);
     const SlotId used_slot = getNextUsedSlot(Page::INVALID_SLOT /* start */);
@@ -50,7 +50,7 @@ class PageIterator {
    * @param page        Page to iterate over.
    * @param record_id   ID of record to start iterator at.
    */
-  PageIterator(Page* page, const RecordId& record_id)
+  PageIterator(const Page* page, const RecordId& record_id)
       : page_(page),
         current_record_(record_id) {
   }
@@ -101,6 +101,25 @@ class PageIterator {
 		return page_->getRecord(current_record_); 
 	}
 
+  /**
+   * Returns a view of the current record in the page without copying it.
+   * See RecordView for how long it stays valid.
+   *
+   * @return  View of record in page.
+   */
+	inline RecordView view() const {
+		return page_->viewRecord(current_record_);
+	}
+
+  /**
+   * Returns the ID of the current record in the page.
+   *
+   * @return  ID of record.
+   */
+	inline const RecordId& record_id() const {
+		return current_record_;
+	}
+
   /**
    * Returns the next used slot in the page after the given slot or
    * Page::INVALID_SLOT if no slots are used after the given slot.
@@ -109,22 +128,14 @@ class PageIterator {
    * @return  Next used slot after given slot or Page::INVALID_SLOT.
    */
   SlotId getNextUsedSlot(const SlotId start) const {
-    SlotId slot_number = Page::INVALID_SLOT;
-    for (SlotId i = start + 1; i <= page_->header_.num_slots; ++i) {
-      const PageSlot* slot = page_->getSlot(i);
-      if (slot->used) {
-        slot_number = i;
-        break;
-      }
-    }
-    return slot_number;
+    return page_->findSlot(start, true /* used */);
   }
 
  private:
   /**
    * Page we're iterating over.
    */
-  Page* page_;
+  const Page* page_;
 
   /**
    * ID of record iterator is currently pointing to.
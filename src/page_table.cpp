@@ -0,0 +1,73 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_table.h"
+
+namespace badgerdb {
+
+const std::uint32_t PageTable::CHUNK_SIZE;
+const FrameId PageTable::NO_FRAME;
+
+PageTable::PageTable(const PageId num_pages)
+    : directory_(new Directory()) {
+  reserve(num_pages);
+}
+
+PageTable::~PageTable() {
+  Directory* directory = directory_.load();
+  for (std::atomic<FrameId>* chunk : directory->chunks) {
+    delete[] chunk;
+  }
+  delete directory;
+}
+
+void PageTable::reserve(const PageId num_pages) {
+  const std::size_t needed =
+      (static_cast<std::size_t>(num_pages) + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  if (directory_.load(std::memory_order_acquire)->chunks.size() >= needed) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(grow_latch_);
+  Directory* old_directory = directory_.load();
+  if (old_directory->chunks.size() >= needed) {
+    // Another thread grew the table meanwhile.
+    return;
+  }
+  Directory* directory = new Directory(*old_directory);
+  while (directory->chunks.size() < needed) {
+    std::atomic<FrameId>* chunk = new std::atomic<FrameId>[CHUNK_SIZE];
+    for (std::uint32_t i = 0; i < CHUNK_SIZE; ++i) {
+      chunk[i].store(NO_FRAME, std::memory_order_relaxed);
+    }
+    directory->chunks.push_back(chunk);
+  }
+  directory_.store(directory, std::memory_order_release);
+  retired_.push_back(std::unique_ptr<Directory>(old_directory));
+}
+
+std::atomic<FrameId>& PageTable::entry(const PageId page_number) {
+  reserve(page_number + 1);
+  return directory_.load(std::memory_order_acquire)
+      ->chunks[page_number / CHUNK_SIZE][page_number % CHUNK_SIZE];
+}
+
+bool PageTable::tryInsert(const PageId page_number, const FrameId frame) {
+  FrameId expected = NO_FRAME;
+  return entry(page_number).compare_exchange_strong(
+      expected, frame, std::memory_order_acq_rel);
+}
+
+bool PageTable::tryRemove(const PageId page_number) {
+  FrameId frame;
+  if (!tryLookup(page_number, frame)) {
+    return false;
+  }
+  return entry(page_number).exchange(NO_FRAME, std::memory_order_acq_rel) !=
+      NO_FRAME;
+}
+
+}
@@ -0,0 +1,132 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Dense map from the page numbers of one file to buffer pool frames.
+ *
+ * An alternative to BufHashTbl for hot files: a lookup is an index into an
+ * array with no hashing and no latch.  The array has one entry per page of
+ * the file, so it suits files whose pages are mostly in the pool, not large
+ * and sparsely cached ones.
+ *
+ * Entries are kept in chunks of CHUNK_SIZE that never move once allocated.
+ * Growing the table publishes a new directory of chunks; directories
+ * replaced by a larger one are kept until the table is destroyed, so lookups
+ * running concurrently with growth stay valid.  Every method is threadsafe.
+ */
+class PageTable {
+ public:
+  /**
+   * Number of entries in a chunk.
+   */
+  static const std::uint32_t CHUNK_SIZE = 1024;
+
+  /**
+   * Creates a table with room for the given number of pages.
+   *
+   * @param num_pages   Number of pages to allocate entries for up front.
+   */
+  explicit PageTable(const PageId num_pages);
+
+  /**
+   * Frees the chunks and directories.
+   */
+  ~PageTable();
+
+  /**
+   * Makes sure the table has entries for page numbers below num_pages.
+   *
+   * @param num_pages   Number of pages the table must cover.
+   */
+  void reserve(const PageId num_pages);
+
+  /**
+   * Looks up the frame of a page.
+   *
+   * @param page_number   Page number in the file.
+   * @param frame         Set to the frame of the page if it is present.
+   * @return  Whether the page is in the table.
+   */
+  bool tryLookup(const PageId page_number, FrameId& frame) const {
+    const Directory* directory = directory_.load(std::memory_order_acquire);
+    const std::uint32_t chunk = page_number / CHUNK_SIZE;
+    if (chunk >= directory->chunks.size()) {
+      return false;
+    }
+    const FrameId entry = directory->chunks[chunk][page_number % CHUNK_SIZE]
+                              .load(std::memory_order_acquire);
+    if (entry == NO_FRAME) {
+      return false;
+    }
+    frame = entry;
+    return true;
+  }
+
+  /**
+   * Adds a page, growing the table if needed.
+   *
+   * @param page_number   Page number in the file.
+   * @param frame         Frame holding the page.
+   * @return  False if the page is already in the table.
+   */
+  bool tryInsert(const PageId page_number, const FrameId frame);
+
+  /**
+   * Removes a page.
+   *
+   * @param page_number   Page number in the file.
+   * @return  False if the page was not in the table.
+   */
+  bool tryRemove(const PageId page_number);
+
+ private:
+  /**
+   * Marks an entry whose page is not in the pool.
+   */
+  static const FrameId NO_FRAME = UINT32_MAX;
+
+  /**
+   * Chunks covering page numbers from 0 up to CHUNK_SIZE times their number.
+   */
+  struct Directory {
+    std::vector<std::atomic<FrameId>*> chunks;
+  };
+
+  /**
+   * Returns the entry of a page, growing the table to cover it.
+   */
+  std::atomic<FrameId>& entry(const PageId page_number);
+
+  /**
+   * Current directory.
+   */
+  std::atomic<Directory*> directory_;
+
+  /**
+   * Directories replaced by larger ones, which lookups may still be using.
+   */
+  std::vector<std::unique_ptr<Directory> > retired_;
+
+  /**
+   * Serializes growing the table.
+   */
+  std::mutex grow_latch_;
+};
+
+}
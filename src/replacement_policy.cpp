@@ -0,0 +1,33 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "replacement_policy.h"
+
+#include "arc_policy.h"
+#include "clock_policy.h"
+#include "lru_k_policy.h"
+#include "two_q_policy.h"
+
+namespace badgerdb {
+
+ReplacementPolicy* ReplacementPolicy::create(const ReplacementPolicyType type,
+                                             BufDesc* bufDescTable,
+                                             const std::uint32_t numBufs) {
+  switch (type) {
+    case ReplacementPolicyType::LRU_K:
+      return new LruKPolicy(numBufs);
+    case ReplacementPolicyType::TWO_Q:
+      return new TwoQPolicy(numBufs);
+    case ReplacementPolicyType::ARC:
+      return new ArcPolicy(numBufs);
+    case ReplacementPolicyType::CLOCK:
+    default:
+      return new ClockPolicy(bufDescTable, numBufs);
+  }
+}
+
+}
@@ -0,0 +1,200 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "types.h"
+
+namespace badgerdb {
+
+class File;
+class BufDesc;
+
+/**
+ * @brief Page replacement policies a BufMgr can be constructed with.
+ */
+enum class ReplacementPolicyType {
+  /**
+   * Single reference bit clock over the frames (the original policy).
+   */
+  CLOCK,
+
+  /**
+   * LRU-2: evicts the page whose second most recent reference is oldest.
+   */
+  LRU_K,
+
+  /**
+   * Full 2Q with an A1in FIFO, an Am LRU list and an A1out ghost list.
+   */
+  TWO_Q,
+
+  /**
+   * Adaptive Replacement Cache.
+   */
+  ARC
+};
+
+/**
+ * @brief Identifies a page of a file independently of the frame it is in.
+ *
+ * Used by policies that remember pages after they have been evicted.
+ */
+struct PageKey {
+  /**
+   * File the page belongs to
+   */
+  const File* file;
+
+  /**
+   * Page number within the file
+   */
+  PageId pageNo;
+
+  /**
+   * Returns true if this key refers to the same page as the other.
+   *
+   * @param rhs   Key to compare against.
+   * @return  Whether both keys name the same page.
+   */
+  bool operator==(const PageKey& rhs) const {
+    return file == rhs.file && pageNo == rhs.pageNo;
+  }
+};
+
+/**
+ * @brief Hash functor so PageKey can be used in unordered containers.
+ */
+struct PageKeyHash {
+  std::size_t operator()(const PageKey& key) const {
+    return std::hash<const File*>()(key.file) ^
+        (static_cast<std::size_t>(key.pageNo) * 0x9E3779B97F4A7C15ULL);
+  }
+};
+
+/**
+ * @brief Callback a policy uses to ask the buffer manager for a victim.
+ */
+class VictimCheck {
+ public:
+  virtual ~VictimCheck() {}
+
+  /**
+   * Tries to take the given frame for eviction.  Fails if the frame is pinned,
+   * has I/O in progress or is otherwise unusable right now.  Never blocks.
+   *
+   * @param frame   Frame the policy would like to evict
+   * @return  True if the frame now belongs to the caller and will be evicted.
+   */
+  virtual bool tryClaim(const FrameId frame) = 0;
+};
+
+/**
+ * @brief Interface of a page replacement policy used by BufMgr.
+ *
+ * The policy tracks every frame holding a valid page, from frameLoaded() until
+ * it is either chosen by pickVictim() or probeVictim(), or dropped by
+ * frameFreed().  Free frames are handed out by the buffer manager itself and
+ * never reach the policy.
+ *
+ * Implementations must be threadsafe.  pickVictim() may be called while other
+ * threads report accesses.
+ */
+class ReplacementPolicy {
+ public:
+  /**
+   * Creates a policy of the given type.
+   *
+   * @param type          Which policy to create
+   * @param bufDescTable  Descriptors of the buffer pool frames
+   * @param numBufs       Number of frames in the buffer pool
+   * @return  Newly allocated policy, owned by the caller.
+   */
+  static ReplacementPolicy* create(const ReplacementPolicyType type,
+                                   BufDesc* bufDescTable,
+                                   const std::uint32_t numBufs);
+
+  virtual ~ReplacementPolicy() {}
+
+  /**
+   * Returns a short human readable name of the policy.
+   *
+   * @return  Name of the policy.
+   */
+  virtual const char* name() const = 0;
+
+  /**
+   * Called after a page has been read or allocated into a frame.
+   *
+   * @param frame   Frame now holding the page
+   * @param file    File the page belongs to
+   * @param pageNo  Page number in the file
+   */
+  virtual void frameLoaded(const FrameId frame, const File* file,
+                           const PageId pageNo) = 0;
+
+  /**
+   * Called when readPage() finds the page already in the frame.
+   *
+   * @param frame   Frame that was hit
+   */
+  virtual void frameAccessed(const FrameId frame) = 0;
+
+  /**
+   * Called when a frame's page is dropped without being picked as a victim,
+   * e.g. because its file was flushed or the page disposed.
+   *
+   * @param frame   Frame that no longer holds a page
+   */
+  virtual void frameFreed(const FrameId frame) = 0;
+
+  /**
+   * Called when the buffer pool is resized.  Before the pool shrinks, every
+   * frame at or above the new size has been dropped through frameFreed()
+   * or pickVictim(), and none is reported again until the pool grows back.
+   *
+   * @param numBufs   New number of frames in the buffer pool
+   */
+  virtual void resize(const std::uint32_t numBufs) = 0;
+
+  /**
+   * Chooses a frame to evict and claims it through check.  On success the
+   * policy stops tracking the frame.
+   *
+   * @param file    File of the page that will be loaded into the victim
+   * @param pageNo  Page number of the page that will be loaded
+   * @param check   Used to claim candidate frames
+   * @param frame   Victim frame, set on success
+   * @return  False if every tracked frame is pinned or busy.
+   */
+  virtual bool pickVictim(const File* file, const PageId pageNo,
+                          VictimCheck& check, FrameId& frame) = 0;
+
+  /**
+   * Like pickVictim(), but only offers check the first window frames the
+   * policy would evict next, and leaves the reference state of the frames it
+   * passes over alone.  Lets the buffer manager look for a victim it prefers,
+   * e.g. a clean one, without a sweep of the whole pool and without costing
+   * the skipped frames their place in the eviction order.
+   *
+   * @param file    File of the page that will be loaded into the victim
+   * @param pageNo  Page number of the page that will be loaded
+   * @param check   Used to claim candidate frames
+   * @param window  Most frames offered to check
+   * @param frame   Victim frame, set on success
+   * @return  False if none of the frames offered could be claimed.
+   */
+  virtual bool probeVictim(const File* file, const PageId pageNo,
+                           VictimCheck& check, const std::uint32_t window,
+                           FrameId& frame) = 0;
+};
+
+}
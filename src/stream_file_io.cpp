@@ -0,0 +1,64 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "stream_file_io.h"
+
+#include <cerrno>
+
+#include "exceptions/file_io_exception.h"
+
+namespace badgerdb {
+
+StreamFileIO::StreamFileIO(const std::string& filename, const bool truncate)
+    : FileIO(filename) {
+  std::ios_base::openmode mode =
+      std::fstream::in | std::fstream::out | std::fstream::binary;
+  if (truncate) {
+    mode = mode | std::fstream::trunc;
+  }
+  stream_.open(filename_, mode);
+  if (!stream_) {
+    throw FileIOException(filename_, "open", errno);
+  }
+}
+
+std::size_t StreamFileIO::readAt(char* buffer, const std::size_t length,
+                                 const std::uint64_t offset) {
+  std::lock_guard<std::mutex> guard(latch_);
+  stream_.seekg(offset, std::ios::beg);
+  stream_.read(buffer, length);
+  const std::size_t count = stream_.gcount();
+  if (stream_.bad()) {
+    stream_.clear();
+    throw FileIOException(filename_, "read", errno);
+  }
+  // Reaching the end of the file sets eofbit and failbit; later seeks must
+  // still work.
+  stream_.clear();
+  return count;
+}
+
+void StreamFileIO::writeAt(const char* buffer, const std::size_t length,
+                           const std::uint64_t offset) {
+  std::lock_guard<std::mutex> guard(latch_);
+  stream_.seekp(offset, std::ios::beg);
+  stream_.write(buffer, length);
+  stream_.flush();
+  if (!stream_) {
+    stream_.clear();
+    throw FileIOException(filename_, "write", errno);
+  }
+}
+
+void StreamFileIO::sync() {
+  // Every write is flushed to the operating system already, and a
+  // std::fstream has no way to wait for the disk.
+  std::lock_guard<std::mutex> guard(latch_);
+  stream_.flush();
+}
+
+}
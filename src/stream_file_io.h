@@ -0,0 +1,57 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#include "file_io.h"
+
+namespace badgerdb {
+
+/**
+ * @brief FileIO on a std::fstream.
+ *
+ * The stream has a single position, so a latch makes each seek and the
+ * transfer following it atomic.
+ */
+class StreamFileIO : public FileIO {
+ public:
+  /**
+   * Opens the file.
+   *
+   * @param filename  Name of the file.
+   * @param truncate  Whether to discard the existing contents of the file.
+   * @throws  FileIOException   If the file can't be opened.
+   */
+  StreamFileIO(const std::string& filename, const bool truncate);
+
+  FileBackend backend() const override { return FileBackend::STREAM; }
+
+  std::size_t readAt(char* buffer, const std::size_t length,
+                     const std::uint64_t offset) override;
+
+  void writeAt(const char* buffer, const std::size_t length,
+               const std::uint64_t offset) override;
+
+  void sync() override;
+
+ private:
+  /**
+   * Stream for the file.
+   */
+  std::fstream stream_;
+
+  /**
+   * Serializes use of stream_.
+   */
+  std::mutex latch_;
+};
+
+}
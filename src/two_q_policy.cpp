@@ -0,0 +1,114 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "two_q_policy.h"
+
+namespace badgerdb {
+
+TwoQPolicy::TwoQPolicy(const std::uint32_t numBufs)
+    : kin(numBufs / 4 > 0 ? numBufs / 4 : 1),
+      kout(numBufs / 2 > 0 ? numBufs / 2 : 1),
+      queues(numBufs, NONE),
+      positions(numBufs),
+      keys(numBufs) {
+}
+
+void TwoQPolicy::resize(const std::uint32_t numBufs) {
+  std::lock_guard<std::mutex> guard(latch);
+  kin = numBufs / 4 > 0 ? numBufs / 4 : 1;
+  kout = numBufs / 2 > 0 ? numBufs / 2 : 1;
+  // per frame state is only ever grown; frames past the end are untracked
+  if (numBufs > queues.size()) {
+    queues.resize(numBufs, NONE);
+    positions.resize(numBufs);
+    keys.resize(numBufs);
+  }
+  while (a1out.size() > kout) {
+    a1outIndex.erase(a1out.back());
+    a1out.pop_back();
+  }
+}
+
+void TwoQPolicy::frameLoaded(const FrameId frame, const File* file,
+                             const PageId pageNo) {
+  std::lock_guard<std::mutex> guard(latch);
+  const PageKey key = {file, pageNo};
+  keys[frame] = key;
+  std::unordered_map<PageKey, std::list<PageKey>::iterator, PageKeyHash>::iterator
+      ghost = a1outIndex.find(key);
+  if (ghost != a1outIndex.end()) {
+    // referenced again after leaving A1in, so it is hot
+    a1out.erase(ghost->second);
+    a1outIndex.erase(ghost);
+    queues[frame] = AM;
+  } else {
+    queues[frame] = A1IN;
+  }
+  std::list<FrameId>& queue = listOf(queues[frame]);
+  queue.push_front(frame);
+  positions[frame] = queue.begin();
+}
+
+void TwoQPolicy::frameAccessed(const FrameId frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  // pages on A1in stay where they are; correlated references right after the
+  // first one shouldn't make a page hot
+  if (queues[frame] == AM) {
+    am.splice(am.begin(), am, positions[frame]);
+  }
+}
+
+void TwoQPolicy::frameFreed(const FrameId frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  if (queues[frame] == NONE) {
+    return;
+  }
+  listOf(queues[frame]).erase(positions[frame]);
+  queues[frame] = NONE;
+}
+
+bool TwoQPolicy::pickFrom(const Queue queue, VictimCheck& check,
+                          std::uint32_t window, FrameId& frame) {
+  std::list<FrameId>& frames = listOf(queue);
+  for (std::list<FrameId>::reverse_iterator it = frames.rbegin();
+       it != frames.rend() && window > 0; ++it, window--) {
+    if (check.tryClaim(*it)) {
+      frame = *it;
+      frames.erase(positions[frame]);
+      queues[frame] = NONE;
+      if (queue == A1IN) {
+        a1out.push_front(keys[frame]);
+        a1outIndex[keys[frame]] = a1out.begin();
+        if (a1out.size() > kout) {
+          a1outIndex.erase(a1out.back());
+          a1out.pop_back();
+        }
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TwoQPolicy::pickVictim(const File* file, const PageId pageNo,
+                            VictimCheck& check, FrameId& frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  const Queue first = preferredQueue();
+  const Queue second = first == A1IN ? AM : A1IN;
+  return pickFrom(first, check, listOf(first).size(), frame) ||
+      pickFrom(second, check, listOf(second).size(), frame);
+}
+
+bool TwoQPolicy::probeVictim(const File* file, const PageId pageNo,
+                             VictimCheck& check, const std::uint32_t window,
+                             FrameId& frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  // only the queue a victim is due from, so a probe never takes hot pages
+  return pickFrom(preferredQueue(), check, window, frame);
+}
+
+}
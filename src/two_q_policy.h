@@ -0,0 +1,142 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Full 2Q replacement (Johnson and Shasha).
+ *
+ * Pages seen for the first time enter the A1in FIFO.  Only pages referenced
+ * again after falling out of A1in, which is detected through the A1out list of
+ * recently evicted page numbers, are promoted to the Am LRU list, so one-off
+ * scans cycle through A1in without disturbing Am.
+ */
+class TwoQPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructs a 2Q policy with A1in sized to a quarter of the pool and A1out
+   * remembering half as many pages as the pool holds.
+   *
+   * @param numBufs   Number of frames in the buffer pool
+   */
+  TwoQPolicy(const std::uint32_t numBufs);
+
+  const char* name() const override { return "2Q"; }
+
+  void frameLoaded(const FrameId frame, const File* file,
+                   const PageId pageNo) override;
+
+  void frameAccessed(const FrameId frame) override;
+
+  void frameFreed(const FrameId frame) override;
+
+  void resize(const std::uint32_t numBufs) override;
+
+  bool pickVictim(const File* file, const PageId pageNo,
+                  VictimCheck& check, FrameId& frame) override;
+
+  bool probeVictim(const File* file, const PageId pageNo, VictimCheck& check,
+                   const std::uint32_t window, FrameId& frame) override;
+
+ private:
+  /**
+   * Queue a frame is on
+   */
+  enum Queue { NONE, A1IN, AM };
+
+  /**
+   * Tries to claim a victim from a queue, oldest first.
+   *
+   * @param queue   Queue to take the victim from
+   * @param check   Used to claim candidate frames
+   * @param window  Most frames of the queue offered to check
+   * @param frame   Victim frame, set on success
+   * @return  True if a frame was claimed.
+   */
+  bool pickFrom(const Queue queue, VictimCheck& check, std::uint32_t window,
+                FrameId& frame);
+
+  /**
+   * Returns the queue the next victim should come from.
+   *
+   * @return  A1IN or AM.
+   */
+  Queue preferredQueue() const {
+    return a1in.size() > kin || am.empty() ? A1IN : AM;
+  }
+
+  /**
+   * Returns the list backing a queue.
+   *
+   * @param queue   A1IN or AM
+   * @return  List of frames, newest first.
+   */
+  std::list<FrameId>& listOf(const Queue queue) {
+    return queue == A1IN ? a1in : am;
+  }
+
+  /**
+   * Protects all members below
+   */
+  std::mutex latch;
+
+  /**
+   * Target size of A1in
+   */
+  std::uint32_t kin;
+
+  /**
+   * Maximum size of A1out
+   */
+  std::uint32_t kout;
+
+  /**
+   * Frames holding pages seen once, newest first
+   */
+  std::list<FrameId> a1in;
+
+  /**
+   * Frames holding hot pages, most recently used first
+   */
+  std::list<FrameId> am;
+
+  /**
+   * Pages recently evicted from A1in, newest first
+   */
+  std::list<PageKey> a1out;
+
+  /**
+   * Position of each page in a1out
+   */
+  std::unordered_map<PageKey, std::list<PageKey>::iterator, PageKeyHash> a1outIndex;
+
+  /**
+   * Queue of each frame
+   */
+  std::vector<Queue> queues;
+
+  /**
+   * Position of each frame in its queue
+   */
+  std::vector<std::list<FrameId>::iterator> positions;
+
+  /**
+   * Page held by each frame
+   */
+  std::vector<PageKey> keys;
+};
+
+}